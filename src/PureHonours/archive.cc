@@ -0,0 +1,967 @@
+#include "archive.h"
+#include "session.h"
+#include "session_file.h"
+#include "tokens.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char MAGIC[4] = {'P', 'H', 'A', 'R'};
+
+// Posting lists hold 32-bit row numbers
+const std::uint64_t MAX_ROWS = std::numeric_limits<std::uint32_t>::max();
+
+// Files appended to archive::add_files commits at a time
+const std::size_t COMMIT_EVERY = 256;
+
+const char *const META = "meta";
+const char *const WINNER = "winner.col";
+const char *const LOSER = "loser.col";
+const char *const FAN = "fan.col";
+const char *const FLAGS = "flags.col";
+const char *const SESSION = "session.col";
+const char *const SESSIONS = "sessions.dat";
+const char *const PLAYERS = "players.dat";
+
+/**
+ * Check a filename's extension
+ * @param name Filename
+ * @param extension Extension including the dot
+ * @return True if name ends with extension, false otherwise
+ */
+bool has_extension(const std::string &name, const std::string &extension)
+{
+    return name.size() > extension.size() &&
+           name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/**
+ * Append bytes to a file and flush them to stable storage
+ * @param filename Path of the file, created if missing
+ * @param data Bytes to append
+ * @param size Number of bytes
+ * @return True if successful, false otherwise
+ */
+bool append_file(const std::string &filename, const void *data, std::size_t size)
+{
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char *next = static_cast<const char *>(data);
+    while (size > 0) {
+        const auto written = ::write(fd, next, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0) {
+            ::close(fd);
+            return false;
+        }
+
+        next += written;
+        size -= static_cast<std::size_t>(written);
+    }
+
+    const bool synced = ::fdatasync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+}
+
+/**
+ * Append a vector's contents to a file
+ * @param filename Path of the file
+ * @param items Items to append
+ * @return True if successful, false otherwise
+ */
+template <typename T>
+bool append_items(const std::string &filename, const std::vector<T> &items)
+{
+    return items.empty() || append_file(filename, items.data(), items.size() * sizeof(T));
+}
+
+/**
+ * Cut a file back to its committed length, creating it if missing
+ * @param filename Path of the file
+ * @param size Committed length in bytes
+ * @return True if the file now has that length, false if it was too short
+ */
+bool fit_file(const std::string &filename, std::uint64_t size)
+{
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0) {
+        if (errno != ENOENT || size != 0) {
+            return false;
+        }
+
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+        return fd >= 0 && ::close(fd) == 0;
+    }
+
+    const auto length = static_cast<std::uint64_t>(st.st_size);
+    if (length == size) {
+        return true;
+    }
+
+    return length > size && ::truncate(filename.c_str(), static_cast<off_t>(size)) == 0;
+}
+
+/**
+ * Drop posting entries for rows that were never committed
+ * @param filename Path of the posting list
+ * @param rows Committed row count
+ * @return True if successful, false otherwise
+ */
+bool trim_postings(const std::string &filename, std::uint64_t rows)
+{
+    int fd = ::open(filename.c_str(), O_RDWR);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Entries are ascending, so binary search for the first uncommitted one
+    std::uint64_t low = 0;
+    std::uint64_t high = static_cast<std::uint64_t>(st.st_size) / sizeof(std::uint32_t);
+    const std::uint64_t count = high;
+    while (low < high) {
+        const auto mid = low + (high - low) / 2;
+        std::uint32_t row;
+        if (::pread(fd, &row, sizeof(row), static_cast<off_t>(mid * sizeof(row))) != sizeof(row)) {
+            ::close(fd);
+            return false;
+        }
+
+        if (row < rows) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    bool ok = true;
+    if (low < count || static_cast<std::uint64_t>(st.st_size) != count * sizeof(std::uint32_t)) {
+        ok = ::ftruncate(fd, static_cast<off_t>(low * sizeof(std::uint32_t))) == 0;
+    }
+
+    return ::close(fd) == 0 && ok;
+}
+
+/**
+ * Copy a string into a fixed-size field
+ * @param field Field to fill; always NUL-terminated
+ * @param size Size of the field
+ * @param text Text to copy, truncated to fit
+ */
+void copy_field(char *field, std::size_t size, const std::string &text)
+{
+    std::memset(field, 0, size);
+    std::memcpy(field, text.data(), std::min(text.size(), size - 1));
+}
+
+/**
+ * Read a fixed-size string field
+ * @param field Field to read
+ * @param size Size of the field
+ * @return Text up to the first NUL
+ */
+const std::string read_field(const char *field, std::size_t size)
+{
+    return std::string(field, ::strnlen(field, size));
+}
+
+/**
+ * Load a finished game from a history or session file
+ * @param filename Path of the file
+ * @return Game, or nullptr if the file could not be read
+ */
+std::unique_ptr<PureHonours> load_game(const std::string &filename)
+{
+    if (has_extension(filename, ".phs")) {
+        session_file::Reader reader;
+        if (!reader.open(filename)) {
+            return nullptr;
+        }
+
+        return session_file::load(reader);
+    }
+
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        return nullptr;
+    }
+
+    Session session(nullptr);
+    session.replay(in);
+    if (!session.game()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<PureHonours> game(new PureHonours(*session.game()));
+    game->set_output(nullptr);
+    return game;
+}
+
+/**
+ * Recursively collect history and session files below a directory
+ *
+ * Symbolic links to directories are not followed, so a link back up the
+ * tree cannot loop.
+ * @param directory Directory to scan
+ * @param files Paths are appended here
+ */
+void scan(const std::string &directory, std::vector<std::string> &files)
+{
+    auto dir = ::opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+
+    while (auto entry = ::readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        const auto path = directory + "/" + name;
+        struct stat st;
+        if (::lstat(path.c_str(), &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            scan(path, files);
+        } else if (S_ISLNK(st.st_mode) && (::stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode))) {
+            continue;
+        } else if (has_extension(name, ".purehonours") || has_extension(name, ".phs")) {
+            files.push_back(path);
+        }
+    }
+
+    ::closedir(dir);
+}
+
+} // namespace
+
+namespace archive
+{
+
+/**
+ * Check whether the round names a paying loser
+ * @return True unless the round was a plain self-draw
+ */
+bool Match::has_loser() const
+{
+    return (flags & Round::SELF_DRAW) == 0 || (flags & Round::GONG_DIRECT) != 0;
+}
+
+Mapping::Mapping()
+: data_(nullptr),
+  size_(0)
+{
+}
+
+Mapping::~Mapping()
+{
+    close();
+}
+
+/**
+ * Map a file read-only
+ * @param filename Path of the file
+ * @return True if successful, false otherwise
+ */
+bool Mapping::open(const std::string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // An empty file cannot be mapped, but is a valid empty column
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        size_ = 0;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Unmap the file
+ */
+void Mapping::close()
+{
+    if (data_) {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+    }
+
+    size_ = 0;
+}
+
+/**
+ * Get mapped bytes
+ * @return Start of the file, or nullptr if empty
+ */
+const void *Mapping::data() const
+{
+    return data_;
+}
+
+/**
+ * Get mapped length
+ * @return Size of the file in bytes
+ */
+std::size_t Mapping::size() const
+{
+    return size_;
+}
+
+/**
+ * Open an archive, creating it if the directory has none
+ *
+ * Anything written past the committed counts by an interrupted commit is
+ * trimmed off before the columns are mapped.
+ * @param directory Archive directory
+ * @return True if successful, false otherwise
+ */
+bool Archive::open(const std::string &directory)
+{
+    directory_ = directory;
+    pending_ = Pending();
+    if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    std::ifstream in(path(META), std::ios::binary);
+    meta_ = Meta();
+    if (!in.is_open()) {
+        std::memcpy(meta_.magic, MAGIC, sizeof(MAGIC));
+        meta_.version = VERSION;
+    } else if (!in.read(reinterpret_cast<char *>(&meta_), sizeof(meta_)) ||
+               !std::equal(meta_.magic, meta_.magic + sizeof(MAGIC), MAGIC) ||
+               meta_.version != VERSION) {
+        return false;
+    }
+
+    return recover() && map();
+}
+
+/**
+ * Stage a finished game's live rounds as a new session
+ * @param game Game to archive
+ * @param source Name to record it under, such as its file path
+ * @return True if staged, false if the archive would overflow
+ */
+bool Archive::append(const PureHonours &game, const std::string &source)
+{
+    const std::uint64_t first_row = meta_.rows + pending_.winner.size();
+    const std::uint64_t session = meta_.sessions + pending_.sessions.size();
+    if (first_row + game.round_count() > MAX_ROWS ||
+        session >= std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+
+    SessionRecord record = SessionRecord();
+    const auto &names = game.player_names();
+    record.first_row = first_row;
+    record.rows = game.round_count();
+    record.player_count = static_cast<std::uint8_t>(names.size());
+    for (std::size_t seat = 0; seat < names.size() && seat < MAX_PLAYERS; ++seat) {
+        record.players[seat] = player_id(names[seat]);
+    }
+    copy_field(record.source, SOURCE_LENGTH, source);
+
+    std::uint32_t row = static_cast<std::uint32_t>(first_row);
+    for (auto &round : game.rounds()) {
+        if (round.deleted()) {
+            continue;
+        }
+
+        pending_.winner.push_back(round.winning_player);
+        pending_.loser.push_back(round.losing_player);
+        pending_.fan.push_back(round.fan);
+        pending_.flags.push_back(round.flags & (Round::SELF_DRAW | Round::GONG_DIRECT));
+        pending_.session.push_back(static_cast<std::uint32_t>(session));
+
+        pending_.won[record.players[round.winning_player]].push_back(row);
+        if (!round.self_draw() || round.gong_direct()) {
+            pending_.lost[record.players[round.losing_player]].push_back(row);
+        }
+        ++row;
+    }
+
+    pending_.sessions.push_back(record);
+    sources_[read_field(record.source, SOURCE_LENGTH)] = static_cast<std::uint32_t>(session);
+    return true;
+}
+
+/**
+ * Write staged sessions to disk and make them visible to queries
+ *
+ * Columns and posting lists are appended and flushed before the meta file
+ * is replaced, so a crash at any point leaves the previous commit intact.
+ * @return True if successful, false otherwise (staged sessions are dropped)
+ */
+bool Archive::commit()
+{
+    if (pending_.sessions.empty()) {
+        return true;
+    }
+
+    // Posting lists of new players may hold leftovers of an interrupted commit
+    bool ok = true;
+    const std::uint64_t new_players = meta_.players + pending_.players.size();
+    for (auto id = meta_.players; id < new_players && ok; ++id) {
+        ok = fit_file(postings(static_cast<std::uint32_t>(id), true), 0) &&
+             fit_file(postings(static_cast<std::uint32_t>(id), false), 0);
+    }
+
+    ok = ok &&
+         append_items(path(WINNER), pending_.winner) &&
+         append_items(path(LOSER), pending_.loser) &&
+         append_items(path(FAN), pending_.fan) &&
+         append_items(path(FLAGS), pending_.flags) &&
+         append_items(path(SESSION), pending_.session) &&
+         append_items(path(SESSIONS), pending_.sessions) &&
+         append_items(path(PLAYERS), pending_.players);
+    for (auto &list : pending_.won) {
+        ok = ok && append_items(postings(list.first, true), list.second);
+    }
+    for (auto &list : pending_.lost) {
+        ok = ok && append_items(postings(list.first, false), list.second);
+    }
+
+    Meta meta = meta_;
+    meta.rows += pending_.winner.size();
+    meta.sessions += pending_.sessions.size();
+    meta.players = new_players;
+
+    // Replace the meta file atomically, then make the rename durable
+    const auto temporary = path(META) + ".tmp";
+    ok = ok &&
+         append_file(temporary, &meta, sizeof(meta)) &&
+         ::rename(temporary.c_str(), path(META).c_str()) == 0;
+    if (ok) {
+        int dir = ::open(directory_.c_str(), O_RDONLY);
+        ok = dir >= 0 && ::fsync(dir) == 0;
+        if (dir >= 0) {
+            ::close(dir);
+        }
+    }
+
+    if (!ok) {
+        std::remove(temporary.c_str());
+        open(directory_);
+        return false;
+    }
+
+    meta_ = meta;
+    pending_ = Pending();
+    return map();
+}
+
+/**
+ * Check whether a source has already been archived or staged
+ * @param source Name the session was recorded under
+ * @return True if archived, false otherwise
+ */
+bool Archive::contains(const std::string &source) const
+{
+    return sources_.count(source.substr(0, SOURCE_LENGTH - 1)) > 0;
+}
+
+/**
+ * Find committed rounds
+ *
+ * A query naming a player walks the shorter of the named players' posting
+ * lists, so only that player's rounds are read; the list already settles
+ * one of the players, and the other is checked through the session table.
+ * Otherwise every row's fan is checked. Once `limit` matches are kept, the
+ * rest are only counted.
+ * @param query Rounds to find
+ * @return Matching rounds and counts
+ */
+Result Archive::query(const Query &query) const
+{
+    Result result;
+    std::uint32_t winner_id = 0;
+    std::uint32_t loser_id = 0;
+    const bool by_winner = !query.winner.empty();
+    const bool by_loser = !query.loser.empty();
+    const unsigned min_fan = static_cast<unsigned>(std::max(query.min_fan, 0));
+    const unsigned max_fan = static_cast<unsigned>(std::min(std::max(query.max_fan, -1), MAX_FAN) + 1);
+    const unsigned fan_span = max_fan > min_fan ? max_fan - min_fan : 0;
+    if ((by_winner && !find_player(query.winner, winner_id)) ||
+        (by_loser && !find_player(query.loser, loser_id)) ||
+        fan_span == 0) {
+        return result;
+    }
+
+    const auto *winner = static_cast<const std::uint8_t *>(winner_.data());
+    const auto *loser = static_cast<const std::uint8_t *>(loser_.data());
+    const auto *fan = static_cast<const std::uint8_t *>(fan_.data());
+    const auto *flags = static_cast<const std::uint8_t *>(flags_.data());
+    const auto *session = static_cast<const std::uint32_t *>(session_.data());
+    const auto *sessions = static_cast<const SessionRecord *>(sessions_.data());
+
+    // Fan range test without branches: fan - min < max + 1 - min
+    auto in_range = [&](std::uint64_t row) {
+        return static_cast<unsigned>(fan[row] - min_fan) < fan_span;
+    };
+
+    auto keep = [&](std::uint64_t row) {
+        Match match;
+        const auto &record = sessions[session[row]];
+        match.row = row;
+        match.session = session[row];
+        match.winner = record.players[winner[row]];
+        match.loser = record.players[loser[row]];
+        match.fan = fan[row];
+        match.flags = flags[row];
+        result.matches.push_back(match);
+    };
+
+    if (!by_winner && !by_loser) {
+        std::uint64_t row = 0;
+        for (; row < meta_.rows && result.matches.size() < query.limit; ++row) {
+            if (in_range(row)) {
+                keep(row);
+            }
+        }
+
+        std::size_t rest = 0;
+        for (; row < meta_.rows; ++row) {
+            rest += in_range(row);
+        }
+
+        result.count = result.matches.size() + rest;
+        result.scanned = meta_.rows;
+        return result;
+    }
+
+    // A player with no posting file yet has no rounds of that kind
+    Mapping won;
+    Mapping lost;
+    if (by_winner) {
+        won.open(postings(winner_id, true));
+    }
+    if (by_loser) {
+        lost.open(postings(loser_id, false));
+    }
+
+    const bool use_won = !by_loser || (by_winner && won.size() <= lost.size());
+    const Mapping &list = use_won ? won : lost;
+    const auto *begin = static_cast<const std::uint32_t *>(list.data());
+    const auto *end = begin ? begin + list.size() / sizeof(std::uint32_t) : begin;
+    end = std::lower_bound(begin, end, meta_.rows);
+    result.scanned = static_cast<std::size_t>(end - begin);
+
+    // Check whichever named player the list does not already settle
+    auto other_matches = [&](std::uint64_t row) {
+        const auto &record = sessions[session[row]];
+        if (use_won) {
+            const bool named = (flags[row] & Round::SELF_DRAW) == 0 ||
+                               (flags[row] & Round::GONG_DIRECT) != 0;
+            return !by_loser || (named && record.players[loser[row]] == loser_id);
+        }
+
+        return !by_winner || record.players[winner[row]] == winner_id;
+    };
+
+    for (auto it = begin; it != end; ++it) {
+        if (in_range(*it) && other_matches(*it)) {
+            ++result.count;
+            if (result.matches.size() < query.limit) {
+                keep(*it);
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Get number of committed rounds
+ * @return Number of rows
+ */
+std::size_t Archive::rows() const
+{
+    return static_cast<std::size_t>(meta_.rows);
+}
+
+/**
+ * Get number of committed sessions
+ * @return Number of sessions
+ */
+std::size_t Archive::sessions() const
+{
+    return static_cast<std::size_t>(meta_.sessions);
+}
+
+/**
+ * Get number of committed players
+ * @return Number of players
+ */
+std::size_t Archive::players() const
+{
+    return static_cast<std::size_t>(meta_.players);
+}
+
+/**
+ * Get a committed session
+ * @param index Session id
+ * @return Session record
+ */
+const SessionRecord &Archive::session(std::size_t index) const
+{
+    return static_cast<const SessionRecord *>(sessions_.data())[index];
+}
+
+/**
+ * Get a player's initials
+ * @param id Player id
+ * @return Initials, or an empty string if not committed
+ */
+const std::string Archive::player_name(std::size_t id) const
+{
+    if (id >= meta_.players) {
+        return "";
+    }
+
+    const auto &record = static_cast<const PlayerRecord *>(players_.data())[id];
+    return read_field(record.name, NAME_LENGTH);
+}
+
+/**
+ * Get path of a file in the archive
+ * @param name Filename
+ * @return Path below the archive directory
+ */
+const std::string Archive::path(const std::string &name) const
+{
+    return directory_ + "/" + name;
+}
+
+/**
+ * Get path of a posting list
+ * @param player Player id
+ * @param won True for rounds won, false for rounds paid as named loser
+ * @return Path below the archive directory
+ */
+const std::string Archive::postings(std::uint32_t player, bool won) const
+{
+    return path((won ? "won." : "lost.") + std::to_string(player));
+}
+
+/**
+ * Trim every file back to the committed counts
+ * @return True if successful, false if a file is missing committed data
+ */
+bool Archive::recover()
+{
+    const auto rows = meta_.rows;
+    if (!fit_file(path(WINNER), rows) ||
+        !fit_file(path(LOSER), rows) ||
+        !fit_file(path(FAN), rows) ||
+        !fit_file(path(FLAGS), rows) ||
+        !fit_file(path(SESSION), rows * sizeof(std::uint32_t)) ||
+        !fit_file(path(SESSIONS), meta_.sessions * sizeof(SessionRecord)) ||
+        !fit_file(path(PLAYERS), meta_.players * sizeof(PlayerRecord))) {
+        return false;
+    }
+
+    for (std::uint64_t id = 0; id < meta_.players; ++id) {
+        if (!trim_postings(postings(static_cast<std::uint32_t>(id), true), rows) ||
+            !trim_postings(postings(static_cast<std::uint32_t>(id), false), rows)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Map the committed columns and index players and sources
+ * @return True if successful, false otherwise
+ */
+bool Archive::map()
+{
+    if (!winner_.open(path(WINNER)) ||
+        !loser_.open(path(LOSER)) ||
+        !fan_.open(path(FAN)) ||
+        !flags_.open(path(FLAGS)) ||
+        !session_.open(path(SESSION)) ||
+        !sessions_.open(path(SESSIONS)) ||
+        !players_.open(path(PLAYERS))) {
+        return false;
+    }
+
+    player_ids_.clear();
+    for (std::uint64_t id = 0; id < meta_.players; ++id) {
+        player_ids_[player_name(static_cast<std::size_t>(id))] = static_cast<std::uint32_t>(id);
+    }
+
+    sources_.clear();
+    for (std::uint64_t i = 0; i < meta_.sessions; ++i) {
+        sources_[read_field(session(static_cast<std::size_t>(i)).source, SOURCE_LENGTH)] =
+            static_cast<std::uint32_t>(i);
+    }
+
+    return true;
+}
+
+/**
+ * Find or stage a player id
+ * @param name Player initials
+ * @return Id of the player
+ */
+std::uint32_t Archive::player_id(const std::string &name)
+{
+    PlayerRecord record;
+    copy_field(record.name, NAME_LENGTH, name);
+    const auto key = read_field(record.name, NAME_LENGTH);
+
+    auto it = player_ids_.find(key);
+    if (it != player_ids_.end()) {
+        return it->second;
+    }
+
+    const auto id = static_cast<std::uint32_t>(meta_.players + pending_.players.size());
+    pending_.players.push_back(record);
+    player_ids_[key] = id;
+    return id;
+}
+
+/**
+ * Find a committed player from entered initials
+ * @param name Initials, matched as typed or upper-cased
+ * @param id Set to the player's id if found
+ * @return True if found, false otherwise
+ */
+bool Archive::find_player(const std::string &name, std::uint32_t &id) const
+{
+    auto it = player_ids_.find(name);
+    if (it == player_ids_.end()) {
+        auto upper = name;
+        for (auto &c : upper) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        it = player_ids_.find(upper);
+    }
+
+    if (it == player_ids_.end() || it->second >= meta_.players) {
+        return false;
+    }
+
+    id = it->second;
+    return true;
+}
+
+/**
+ * Find history (.purehonours) and session (.phs) files
+ * @param path File, or directory to search recursively
+ * @return Matching paths, sorted
+ */
+std::vector<std::string> find_files(const std::string &path)
+{
+    std::vector<std::string> files;
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return files;
+    } else if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return files;
+    }
+
+    scan(path, files);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+/**
+ * Archive every file not archived yet
+ * @param archive Archive to append to
+ * @param files History or session files, each one session
+ * @param out Stream for progress and failures
+ * @return Number of sessions added
+ */
+std::size_t add_files(Archive &archive,
+                      const std::vector<std::string> &files,
+                      std::ostream &out)
+{
+    std::size_t added = 0;
+    std::size_t skipped = 0;
+    std::size_t staged = 0;
+    std::size_t rounds = 0;
+
+    for (auto &file : files) {
+        // Record sources by absolute path so re-adding a directory is a no-op
+        char *resolved = ::realpath(file.c_str(), nullptr);
+        const std::string source = resolved ? resolved : file;
+        std::free(resolved);
+        if (archive.contains(source)) {
+            ++skipped;
+            continue;
+        }
+
+        auto game = load_game(file);
+        if (!game) {
+            out << "Unreadable: " << file << std::endl;
+            continue;
+        } else if (!archive.append(*game, source)) {
+            out << "Archive is full; stopped before: " << file << std::endl;
+            break;
+        }
+
+        rounds += game->round_count();
+        if (++staged == COMMIT_EVERY) {
+            if (!archive.commit()) {
+                out << "Failed to write archive." << std::endl;
+                return added;
+            }
+            added += staged;
+            staged = 0;
+        }
+    }
+
+    if (!archive.commit()) {
+        out << "Failed to write archive." << std::endl;
+        return added;
+    }
+    added += staged;
+
+    out << "Archived " << added << " sessions (" << rounds << " rounds)";
+    if (skipped > 0) {
+        out << ", " << skipped << " already archived";
+    }
+    out << "." << std::endl;
+    return added;
+}
+
+/**
+ * Parse a query such as "winner:AB,loser:CD,min-fan:10,limit:50"
+ * @param text Comma-separated key:value pairs
+ * @param query Query to fill in
+ * @return True if successful, false otherwise
+ */
+bool parse_query(const std::string &text, Query &query)
+{
+    std::size_t start = 0;
+    while (start < text.size()) {
+        auto end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+
+        const auto item = text.substr(start, end - start);
+        const auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+
+        const auto key = item.substr(0, colon);
+        const tokens::Token value(item.data() + colon + 1, item.size() - colon - 1);
+        if (key == "winner") {
+            query.winner = value.str();
+        } else if (key == "loser") {
+            query.loser = value.str();
+        } else if (key == "min-fan") {
+            if (!tokens::to_int(value, query.min_fan)) {
+                return false;
+            }
+        } else if (key == "max-fan") {
+            if (!tokens::to_int(value, query.max_fan)) {
+                return false;
+            }
+        } else if (key == "limit") {
+            if (!tokens::to_size(value, query.limit)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Print query results
+ * @param archive Archive that was queried
+ * @param query Query that was run
+ * @param result Matching rounds
+ * @param milliseconds Time the query took
+ * @param out Stream to print to
+ */
+void print(const Archive &archive,
+           const Query &query,
+           const Result &result,
+           double milliseconds,
+           std::ostream &out)
+{
+    for (auto &match : result.matches) {
+        const auto &session = archive.session(match.session);
+        out << "Session " << match.session + 1
+            << " round " << match.row - session.first_row + 1 << ": "
+            << archive.player_name(match.winner) << " wins "
+            << static_cast<int>(match.fan) << " fan ";
+
+        if (!match.has_loser()) {
+            out << "by self draw";
+        } else if (match.flags & Round::SELF_DRAW) {
+            out << "by self draw off a gong from " << archive.player_name(match.loser);
+        } else {
+            out << "from " << archive.player_name(match.loser);
+        }
+
+        out << " (" << read_field(session.source, SOURCE_LENGTH) << ")\n";
+    }
+
+    out << result.count << " matching rounds";
+    if (result.count > query.limit) {
+        out << " (first " << query.limit << " shown)";
+    }
+    out << ", " << result.scanned << " of " << archive.rows() << " rounds examined in "
+        << std::fixed << std::setprecision(3) << milliseconds << " ms." << std::endl;
+}
+
+} // namespace archive
@@ -0,0 +1,185 @@
+#ifndef __ARCHIVE_H
+#define __ARCHIVE_H
+
+#include "purehonours.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Long-term store of every archived round, kept column by column
+//
+// An archive is a directory of append-only files. Each round is one row
+// across the winner, loser, fan and flags columns (a byte each) and the
+// session column (four bytes). Seats are resolved to players through the
+// session table. Every player has two posting lists of ascending row numbers,
+// rounds they won and rounds they paid as the named loser, so a query about
+// a player only touches that player's rounds. The meta file holds the
+// committed counts and is written last, so anything past them left by an
+// interrupted append is trimmed on open. Fields are stored in host byte
+// order.
+namespace archive
+{
+
+const std::uint16_t VERSION = 1;
+const std::size_t NAME_LENGTH = 16;
+const std::size_t SOURCE_LENGTH = 216;
+
+struct Meta {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint64_t rows;
+    std::uint64_t sessions;
+    std::uint64_t players;
+};
+
+// One archived game; its rounds are rows [first_row, first_row + rows)
+struct SessionRecord {
+    std::uint64_t first_row;
+    std::uint64_t rows;
+    std::uint32_t players[MAX_PLAYERS]; // Player id for each seat
+    std::uint8_t player_count;
+    std::uint8_t reserved[7];
+    char source[SOURCE_LENGTH];
+};
+
+struct PlayerRecord {
+    char name[NAME_LENGTH];
+};
+
+static_assert(sizeof(Meta) == 32, "Meta layout changed");
+static_assert(sizeof(SessionRecord) == 256, "SessionRecord layout changed");
+static_assert(sizeof(PlayerRecord) == 16, "PlayerRecord layout changed");
+
+// Rounds to find; empty names and the full fan range match anything
+struct Query {
+    std::string winner;
+    std::string loser;
+    int min_fan = 0;
+    int max_fan = 255;
+    std::size_t limit = 20;
+};
+
+// One matching round
+struct Match {
+    std::uint64_t row;
+    std::uint32_t session;
+    std::uint32_t winner;
+    std::uint32_t loser; // Only meaningful if has_loser()
+    std::uint8_t fan;
+    std::uint8_t flags;
+
+    bool has_loser() const;
+};
+
+struct Result {
+    std::vector<Match> matches; // The first `limit` matches, oldest first
+    std::size_t count = 0;      // Every match
+    std::size_t scanned = 0;    // Rows examined
+};
+
+/**
+ * Read-only mapping of a whole file
+ */
+class Mapping {
+public:
+    Mapping();
+    ~Mapping();
+
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+
+    bool open(const std::string &filename);
+    void close();
+
+    const void *data() const;
+    std::size_t size() const;
+
+private:
+    void *data_;
+    std::size_t size_;
+};
+
+/**
+ * Columnar round archive kept in a directory
+ *
+ * Appended games are staged in memory until commit() writes them to the
+ * column and posting files and then the meta file. Queries only see
+ * committed rounds.
+ */
+class Archive {
+public:
+    Archive() = default;
+
+    Archive(const Archive &) = delete;
+    Archive &operator=(const Archive &) = delete;
+
+    bool open(const std::string &directory);
+    bool append(const PureHonours &game, const std::string &source);
+    bool commit();
+    bool contains(const std::string &source) const;
+    Result query(const Query &query) const;
+
+    std::size_t rows() const;
+    std::size_t sessions() const;
+    std::size_t players() const;
+    const SessionRecord &session(std::size_t index) const;
+    const std::string player_name(std::size_t id) const;
+
+private:
+    // Appended rows not yet committed
+    struct Pending {
+        std::vector<std::uint8_t> winner;
+        std::vector<std::uint8_t> loser;
+        std::vector<std::uint8_t> fan;
+        std::vector<std::uint8_t> flags;
+        std::vector<std::uint32_t> session;
+        std::vector<SessionRecord> sessions;
+        std::vector<PlayerRecord> players;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> won;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> lost;
+    };
+
+    std::string directory_;
+    Meta meta_ = Meta();
+    Pending pending_;
+    std::unordered_map<std::string, std::uint32_t> player_ids_;
+    std::unordered_map<std::string, std::uint32_t> sources_;
+
+    Mapping winner_;
+    Mapping loser_;
+    Mapping fan_;
+    Mapping flags_;
+    Mapping session_;
+    Mapping sessions_;
+    Mapping players_;
+
+    const std::string path(const std::string &name) const;
+    const std::string postings(std::uint32_t player, bool won) const;
+    bool recover();
+    bool map();
+    std::uint32_t player_id(const std::string &name);
+    bool find_player(const std::string &name, std::uint32_t &id) const;
+};
+
+std::vector<std::string> find_files(const std::string &path);
+
+std::size_t add_files(Archive &archive,
+                      const std::vector<std::string> &files,
+                      std::ostream &out);
+
+bool parse_query(const std::string &text, Query &query);
+
+void print(const Archive &archive,
+           const Query &query,
+           const Result &result,
+           double milliseconds,
+           std::ostream &out);
+
+} // namespace archive
+
+#endif // __ARCHIVE_H
@@ -0,0 +1,133 @@
+#include "batch.h"
+#include "output_buffer.h"
+
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+// Bytes read from the input per call
+const std::size_t READ_SIZE = 1 << 20;
+
+} // namespace
+
+namespace batch
+{
+
+/**
+ * Parse a report name
+ * @param name One of "none", "scores", "full", "csv" or "csv-stdout"
+ * @param report Set to the matching report
+ * @return True if the name is valid, false otherwise
+ */
+bool parse_report(const std::string &name, Report &report)
+{
+    if (name == "none") {
+        report = Report::None;
+    } else if (name == "scores") {
+        report = Report::Scores;
+    } else if (name == "full") {
+        report = Report::Full;
+    } else if (name == "csv") {
+        report = Report::Csv;
+    } else if (name == "csv-stdout") {
+        report = Report::CsvStdout;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Feed every line of a file through a session without any output
+ * @param in File to read commands from
+ * @param session Session to feed
+ * @return Number of lines processed
+ */
+std::size_t run(std::FILE *in, Session &session)
+{
+    session.set_output(nullptr);
+
+    std::vector<char> buffer(READ_SIZE);
+    std::string line;
+    std::size_t count = 0;
+    bool quit = false;
+
+    while (!quit) {
+        const auto read = std::fread(buffer.data(), 1, buffer.size(), in);
+        if (read == 0) {
+            break;
+        }
+
+        // Split into lines, carrying any partial line into the next read
+        const char *pos = buffer.data();
+        const char *end = pos + read;
+        while (pos < end) {
+            auto newline = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+            if (!newline) {
+                line.append(pos, end);
+                break;
+            }
+
+            line.append(pos, newline);
+            pos = newline + 1;
+
+            ++count;
+            if (session.feed(line) == Session::Outcome::Quit) {
+                quit = true;
+                break;
+            }
+            line.clear();
+        }
+    }
+
+    // Last line may have no newline
+    if (!quit && !line.empty()) {
+        ++count;
+        session.feed(line);
+    }
+
+    return count;
+}
+
+/**
+ * Print the chosen report for a processed session
+ * @param session Processed session
+ * @param report Report to print
+ */
+void print_report(Session &session, Report report)
+{
+    session.set_output(&std::cout);
+
+    auto game = session.game();
+    if (!game || report == Report::None) {
+        return;
+    }
+
+    switch (report) {
+    case Report::Scores:
+        game->print_scores();
+        break;
+    case Report::Full:
+        game->print_report();
+        break;
+    case Report::Csv:
+        game->print_csv();
+        break;
+    case Report::CsvStdout: {
+        std::cout.flush();
+        FdSink sink(STDOUT_FILENO);
+        OutputBuffer out(sink);
+        game->write_csv(out);
+        break;
+    }
+    case Report::None:
+        break;
+    }
+}
+
+} // namespace batch
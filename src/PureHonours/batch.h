@@ -0,0 +1,31 @@
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include "session.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Non-interactive processing of recorded command streams
+namespace batch
+{
+
+// What to print once the stream has been processed
+enum class Report {
+    None,
+    Scores,
+    Full,
+    Csv,
+    CsvStdout,
+};
+
+bool parse_report(const std::string &name, Report &report);
+
+std::size_t run(std::FILE *in, Session &session);
+
+void print_report(Session &session, Report report);
+
+} // namespace batch
+
+#endif // __BATCH_H
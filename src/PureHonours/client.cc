@@ -0,0 +1,269 @@
+#include "client.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <ostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * Connect to a server
+ * @param address "<host>:<port>", "<port>" on this machine, or a Unix socket path
+ * @return Connected socket, or -1 on failure
+ */
+int connect_to(const std::string &address)
+{
+    if (address.find('/') != std::string::npos) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        std::copy(address.begin(), address.end(), addr.sun_path);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    std::string host = "127.0.0.1";
+    std::string port = address;
+    const auto colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (auto info = found; info && fd < 0; info = info->ai_next) {
+        fd = ::socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd >= 0 && ::connect(fd, info->ai_addr, info->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(found);
+
+    if (fd >= 0) {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+/**
+ * Send a command and wait for its response
+ * @param fd Connected socket
+ * @param line Command to send
+ * @param pending Bytes received past the previous response
+ * @param response Filled with the response, without its terminator
+ * @return True if successful, false otherwise
+ */
+bool request(int fd, const std::string &line, std::string &pending, std::string &response)
+{
+    const auto message = line + '\n';
+    std::size_t sent = 0;
+    while (sent < message.size()) {
+        auto count = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return false;
+        }
+        sent += static_cast<std::size_t>(count);
+    }
+
+    // Responses end with a line holding a single "."
+    char buffer[4096];
+    while (true) {
+        std::size_t end = std::string::npos;
+        if (pending.compare(0, 2, ".\n") == 0) {
+            end = 0;
+        } else {
+            auto found = pending.find("\n.\n");
+            if (found != std::string::npos) {
+                end = found + 1;
+            }
+        }
+
+        if (end != std::string::npos) {
+            response.assign(pending, 0, end);
+            pending.erase(0, end + 2);
+            return true;
+        }
+
+        auto count = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return false;
+        }
+        pending.append(buffer, static_cast<std::size_t>(count));
+    }
+}
+
+/**
+ * Replay commands on one connection and time each response
+ * @param address Server address
+ * @param next Gets the next command; returns false when there are no more
+ * @param latencies Filled with the time taken by each command
+ * @param out Stream for responses, or nullptr to discard them
+ * @return True if every command was answered, false otherwise
+ */
+bool replay(const std::string &address,
+            const std::function<bool(std::string &)> &next,
+            std::vector<Clock::duration> &latencies,
+            std::ostream *out)
+{
+    int fd = connect_to(address);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::string line;
+    std::string pending;
+    std::string response;
+    bool ok = true;
+    while (next(line)) {
+        const auto start = Clock::now();
+        if (!request(fd, line, pending, response)) {
+            ok = false;
+            break;
+        }
+        latencies.push_back(Clock::now() - start);
+
+        if (out) {
+            *out << response << std::flush;
+        }
+
+        // The server closes the connection after a quit
+        if (response == "Bye.\n") {
+            break;
+        }
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+namespace client
+{
+
+/**
+ * Send commands to a server and report response times
+ *
+ * With several clients, each connection sits at its own table and sends
+ * the whole command stream; responses are discarded and only timings shown.
+ *
+ * @param address "<host>:<port>", "<port>" on this machine, or a Unix socket path
+ * @param in Commands to send, one per line
+ * @param out Stream for responses and timings
+ * @param clients Number of concurrent connections
+ * @return Exit status
+ */
+int run(const std::string &address, std::istream &in, std::ostream &out, std::size_t clients)
+{
+    clients = std::max<std::size_t>(1, clients);
+    std::vector<std::vector<Clock::duration>> latencies(clients);
+    std::vector<char> ok(clients, 0);
+    const auto start = Clock::now();
+    if (clients == 1) {
+        // Stream so the client can be driven interactively
+        auto next = [&in](std::string &line) { return static_cast<bool>(std::getline(in, line)); };
+        ok[0] = replay(address, next, latencies[0], &out);
+    } else {
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(in, line)) {
+            lines.push_back(line);
+        }
+
+        std::vector<std::thread> threads;
+        for (std::size_t c = 0; c < clients; ++c) {
+            threads.emplace_back([&address, &lines, &latencies, &ok, c]() {
+                const auto table = "table client" + std::to_string(c + 1);
+                std::size_t i = 0;
+                auto next = [&lines, &table, &i](std::string &line) {
+                    if (i > lines.size()) {
+                        return false;
+                    }
+                    line = i == 0 ? table : lines[i - 1];
+                    ++i;
+                    return true;
+                };
+                ok[c] = replay(address, next, latencies[c], nullptr);
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    const auto elapsed = Clock::now() - start;
+
+    std::vector<Clock::duration> all;
+    for (auto &times : latencies) {
+        all.insert(all.end(), times.begin(), times.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    const auto failed = static_cast<std::size_t>(std::count(ok.begin(), ok.end(), 0));
+    if (failed > 0) {
+        out << failed << " of " << clients << " connections failed." << std::endl;
+    }
+    if (all.empty()) {
+        return failed > 0 ? 1 : 0;
+    }
+
+    auto micros = [](Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    };
+
+    Clock::duration total(0);
+    for (auto &d : all) {
+        total += d;
+    }
+
+    out << all.size() << " commands over " << clients << " connections in "
+        << micros(elapsed) / 1000 << " ms; latency us: mean "
+        << micros(total) / all.size()
+        << ", p50 " << micros(all[all.size() / 2])
+        << ", p99 " << micros(all[all.size() * 99 / 100])
+        << ", max " << micros(all.back()) << std::endl;
+
+    return failed > 0 ? 1 : 0;
+}
+
+} // namespace client
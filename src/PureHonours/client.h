@@ -0,0 +1,19 @@
+#ifndef __CLIENT_H
+#define __CLIENT_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+// Command-line stand-in for a table client of the scoring server
+namespace client
+{
+
+int run(const std::string &address,
+        std::istream &in,
+        std::ostream &out,
+        std::size_t clients = 1);
+
+} // namespace client
+
+#endif // __CLIENT_H
@@ -0,0 +1,202 @@
+#include "core.h"
+
+/**
+ * Constructor for core
+ * @param session Session to take over; only the writer thread uses it afterwards
+ * @param idle_task Deferred work run on the writer thread while idle, if any
+ */
+GameCore::GameCore(Session &&session, IdleTask idle_task)
+: session_(std::move(session)),
+  idle_task_(std::move(idle_task)),
+  submitted_(0),
+  applied_(0),
+  sleeping_(false),
+  stopping_(false),
+  sequence_(0),
+  players_(nullptr),
+  rounds_(0)
+{
+    for (auto &total : totals_) {
+        total.store(0, std::memory_order_relaxed);
+    }
+
+    session_.set_output(nullptr);
+    publish();
+    writer_ = std::thread([this]() { run(); });
+}
+
+/**
+ * Apply queued commands and stop the writer
+ */
+GameCore::~GameCore()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        sleeping_ = false;
+        wake_.notify_one();
+    }
+
+    writer_.join();
+}
+
+/**
+ * Queue a command; never blocks on the writer
+ * @param line Command in the usual session grammar
+ * @param done Called on the writer thread with the outcome and output
+ * @return Number of commands submitted so far, for comparing with Standings::applied
+ */
+std::uint64_t GameCore::submit(const std::string &line, Callback done)
+{
+    const auto ticket = ++submitted_;
+    queue_.push(Command{line, std::move(done)});
+
+    // Pairs with the writer's fence so either it sees the command or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sleeping_ = false;
+        wake_.notify_one();
+    }
+
+    return ticket;
+}
+
+/**
+ * Wait until every command submitted so far has been applied
+ */
+void GameCore::drain()
+{
+    const auto target = submitted_.load();
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this, target]() { return applied_.load() >= target; });
+}
+
+/**
+ * Read the latest published standings without blocking the writer
+ * @return Copy of the standings
+ */
+GameCore::Standings GameCore::standings() const
+{
+    Standings standings;
+    int totals[MAX_PLAYERS];
+    const std::vector<std::string> *players;
+    std::uint64_t before;
+    std::uint64_t after;
+
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        players = players_.load(std::memory_order_relaxed);
+        standings.rounds = static_cast<std::size_t>(rounds_.load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i < MAX_PLAYERS; ++i) {
+            totals[i] = totals_[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    // Two sequence steps per publish, and the constructor publishes once
+    standings.applied = before / 2 - 1;
+    if (players) {
+        standings.players = *players;
+        standings.totals.assign(totals, totals + players->size());
+    }
+
+    return standings;
+}
+
+/**
+ * Writer loop: apply commands until stopped and the queue is empty
+ */
+void GameCore::run()
+{
+    Command command;
+    while (true) {
+        if (queue_.pop(command)) {
+            apply(command);
+            continue;
+        }
+
+        // Deferred work, such as a group commit, is due before sleeping
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (idle_task_) {
+            deadline = idle_task_();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.notify_all();
+        if (stopping_) {
+            break;
+        }
+
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_.pop(command)) {
+            sleeping_ = false;
+            lock.unlock();
+            apply(command);
+            continue;
+        }
+
+        // A producer part-way through a push wakes us once it finishes
+        const auto woken = [this]() { return !sleeping_.load(); };
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            wake_.wait(lock, woken);
+        } else if (!wake_.wait_until(lock, deadline, woken)) {
+            sleeping_ = false;
+        }
+    }
+}
+
+/**
+ * Apply one command and report it
+ * @param command Command to apply
+ */
+void GameCore::apply(Command &command)
+{
+    Session::Outcome outcome;
+    if (command.done) {
+        output_.str("");
+        session_.set_output(&output_);
+        outcome = session_.feed(command.line);
+        session_.set_output(nullptr);
+    } else {
+        outcome = session_.feed(command.line);
+    }
+
+    publish();
+    if (command.done) {
+        command.done(session_, outcome, output_.str());
+        command.done = nullptr;
+    }
+    ++applied_;
+}
+
+/**
+ * Publish standings for readers
+ */
+void GameCore::publish()
+{
+    const auto game = session_.game();
+    const auto sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (game) {
+        // Names never change once the game exists
+        players_.store(&game->player_names(), std::memory_order_relaxed);
+        rounds_.store(game->round_count(), std::memory_order_relaxed);
+        const auto &totals = game->totals();
+        for (std::size_t i = 0; i < totals.size(); ++i) {
+            totals_[i].store(totals[i], std::memory_order_relaxed);
+        }
+    }
+
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
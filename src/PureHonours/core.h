@@ -0,0 +1,89 @@
+#ifndef __CORE_H
+#define __CORE_H
+
+#include "mpsc_queue.h"
+#include "session.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Single-writer game core fed by any number of threads
+ *
+ * Commands go through a lock-free queue and are applied in arrival order
+ * by one writer thread, the only thread that touches the session. Output
+ * is captured and handed to each command's callback, so producers never
+ * wait on the core's I/O. Standings are published through a seqlock and
+ * can be read from any thread without blocking the writer.
+ */
+class GameCore {
+public:
+    // Called on the writer thread once a command has been applied
+    using Callback = std::function<void(const Session &session,
+                                        Session::Outcome outcome,
+                                        const std::string &output)>;
+
+    // Called on the writer thread whenever the queue runs dry; returns when
+    // to be called again if no command arrives first
+    using IdleTask = std::function<std::chrono::steady_clock::time_point()>;
+
+    // Consistent view of the scores
+    struct Standings {
+        std::uint64_t applied = 0; // Commands applied so far
+        std::size_t rounds = 0;
+        std::vector<std::string> players;
+        std::vector<int> totals;
+    };
+
+    explicit GameCore(Session &&session, IdleTask idle_task = nullptr);
+    ~GameCore();
+
+    GameCore(const GameCore &) = delete;
+    GameCore &operator=(const GameCore &) = delete;
+
+    std::uint64_t submit(const std::string &line, Callback done = nullptr);
+    void drain();
+    Standings standings() const;
+
+private:
+    struct Command {
+        std::string line;
+        Callback done;
+    };
+
+    Session session_;
+    IdleTask idle_task_;
+    std::ostringstream output_;
+    MpscQueue<Command> queue_;
+
+    std::atomic<std::uint64_t> submitted_;
+    std::atomic<std::uint64_t> applied_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> stopping_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+
+    // Seqlock-protected standings; odd sequence means a write is under way
+    std::atomic<std::uint64_t> sequence_;
+    std::atomic<const std::vector<std::string> *> players_;
+    std::atomic<std::uint64_t> rounds_;
+    std::atomic<int> totals_[MAX_PLAYERS];
+
+    std::thread writer_;
+
+    void run();
+    void apply(Command &command);
+    void publish();
+};
+
+#endif // __CORE_H
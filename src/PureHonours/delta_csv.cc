@@ -0,0 +1,99 @@
+#include "delta_csv.h"
+#include "metrics.h"
+#include "output_buffer.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Bring the file up to date with the game
+ * @param game Game to export; its rounds are marked as exported
+ * @return True if successful, false otherwise
+ */
+bool DeltaCsv::write(PureHonours &game)
+{
+    METRICS_TIME(Csv);
+
+    if (filename_.empty()) {
+        filename_ = game.export_filename() + ".csv";
+    }
+
+    int fd = ::open(filename_.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Keep rows up to the first changed round, unless the file was touched
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) != size_) {
+        starts_.clear();
+    }
+
+    std::size_t keep = 0;
+    std::size_t offset = 0;
+    if (!starts_.empty()) {
+        keep = std::min(game.unchanged_rounds(), starts_.size() - 1);
+        offset = starts_[keep];
+        starts_.resize(keep);
+    }
+
+    bool written = ::lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0;
+    std::size_t end = offset;
+    if (written) {
+        FdSink sink(fd);
+        OutputBuffer out(sink);
+        if (offset == 0) {
+            game.write_csv_header(out);
+        }
+
+        const auto first = starts_.size();
+        game.write_csv_rows(out, keep, &starts_);
+        starts_.push_back(out.position());
+        for (auto i = first; i < starts_.size(); ++i) {
+            starts_[i] += offset;
+        }
+
+        out.put("Sum", 3);
+        for (auto total : game.totals()) {
+            out.put(',');
+            out.put_int(total);
+        }
+        out.put(",\n", 2);
+
+        written = out.flush();
+        end = offset + out.position();
+    }
+
+    // Drop whatever is left of a longer old tail
+    written = written && ::ftruncate(fd, static_cast<off_t>(end)) == 0;
+    if (::close(fd) != 0 || !written) {
+        starts_.clear();
+        size_ = 0;
+        return false;
+    }
+
+    size_ = end;
+    rows_written_ = starts_.size() - 1 - keep;
+    game.mark_exported();
+    return true;
+}
+
+/**
+ * Get the file being kept up to date
+ * @return Filename, or empty before the first export
+ */
+const std::string &DeltaCsv::filename() const
+{
+    return filename_;
+}
+
+/**
+ * Get the number of round rows the last export wrote
+ * @return Rows written
+ */
+std::size_t DeltaCsv::rows_written() const
+{
+    return rows_written_;
+}
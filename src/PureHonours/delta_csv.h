@@ -0,0 +1,34 @@
+#ifndef __DELTA_CSV_H
+#define __DELTA_CSV_H
+
+#include "purehonours.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * One CSV file per session, brought up to date by rewriting only its tail
+ *
+ * The file holds the title row, a row per live round and a closing Sum row
+ * with the totals. The start of every row is remembered, so an export
+ * after new rounds rewrites just the Sum row and the rounds after it, and
+ * an export after a delete, undo or redo rewrites from the first round
+ * that changed. The file is written from scratch if it is not as it was
+ * left.
+ */
+class DeltaCsv {
+public:
+    bool write(PureHonours &game);
+
+    const std::string &filename() const;
+    std::size_t rows_written() const;
+
+private:
+    std::string filename_;
+    std::vector<std::size_t> starts_; // Start of each round's row, then of the Sum row
+    std::size_t size_ = 0;            // File size after the last export
+    std::size_t rows_written_ = 0;
+};
+
+#endif // __DELTA_CSV_H
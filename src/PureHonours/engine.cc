@@ -0,0 +1,227 @@
+#include "engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+Engine::Table::Table()
+: session(nullptr)
+{
+}
+
+/**
+ * Constructor for engine
+ * @param workers Number of worker threads (0 for one per core)
+ */
+Engine::Engine(std::size_t workers)
+{
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back(new Worker());
+        auto worker = workers_.back().get();
+        worker->thread = std::thread([worker]() { run(*worker); });
+    }
+}
+
+/**
+ * Finish queued commands and stop the workers
+ */
+Engine::~Engine()
+{
+    for (auto &worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->stopping = true;
+        worker->ready.notify_one();
+    }
+
+    for (auto &worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+/**
+ * Queue a command for a table, creating the table on first use
+ * @param table Table id
+ * @param line Command in the usual session grammar
+ * @param done Called with the outcome and output; if empty the command runs quietly
+ */
+void Engine::submit(const std::string &table, const std::string &line, Callback done)
+{
+    auto &worker = worker_for(table);
+    auto owner = &worker;
+
+    post(worker, [owner, table, line, done]() {
+        auto &slot = owner->tables[table];
+        if (!slot) {
+            slot.reset(new Table());
+        }
+
+        auto &t = *slot;
+        if (!done) {
+            t.session.feed(line);
+            return;
+        }
+
+        t.output.str("");
+        t.output.clear();
+        t.session.set_output(&t.output);
+        auto outcome = t.session.feed(line);
+        t.session.set_output(nullptr);
+
+        done(table, outcome, t.output.str());
+    });
+}
+
+/**
+ * Wait until every queued command has been applied
+ */
+void Engine::drain()
+{
+    for (auto &worker : workers_) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->idle.wait(lock, [&worker]() { return worker->jobs.empty() && !worker->busy; });
+    }
+}
+
+/**
+ * Count tables, after commands queued so far
+ * @return Number of tables
+ */
+std::size_t Engine::table_count()
+{
+    std::atomic<std::size_t> total(0);
+    run_all([&total](Worker &worker) {
+        total += worker.tables.size();
+    });
+
+    return total;
+}
+
+/**
+ * Combine player totals across every table, after commands queued so far
+ * @return Standings, highest total first
+ */
+std::vector<Engine::Standing> Engine::standings()
+{
+    std::mutex merge_mutex;
+    std::unordered_map<std::string, Standing> merged;
+
+    run_all([&merge_mutex, &merged](Worker &worker) {
+        // Tally this worker's tables first so the shared lock is brief
+        std::unordered_map<std::string, Standing> local;
+        for (auto &entry : worker.tables) {
+            auto game = entry.second->session.game();
+            if (!game) {
+                continue;
+            }
+
+            const auto &names = game->player_names();
+            const auto &totals = game->totals();
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                auto &standing = local[names[i]];
+                standing.player = names[i];
+                standing.total += totals[i];
+                ++standing.tables;
+                standing.rounds += game->round_count();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        for (auto &entry : local) {
+            auto &standing = merged[entry.first];
+            standing.player = entry.first;
+            standing.total += entry.second.total;
+            standing.tables += entry.second.tables;
+            standing.rounds += entry.second.rounds;
+        }
+    });
+
+    std::vector<Standing> result;
+    for (auto &entry : merged) {
+        result.push_back(entry.second);
+    }
+
+    std::sort(result.begin(), result.end(), [](const Standing &a, const Standing &b) {
+        return a.total != b.total ? a.total > b.total : a.player < b.player;
+    });
+
+    return result;
+}
+
+/**
+ * Pick the worker that owns a table
+ * @param table Table id
+ * @return Owning worker
+ */
+Engine::Worker &Engine::worker_for(const std::string &table)
+{
+    return *workers_[std::hash<std::string>()(table) % workers_.size()];
+}
+
+/**
+ * Queue a job on a worker
+ * @param worker Worker to run the job
+ * @param job Job to run
+ */
+void Engine::post(Worker &worker, std::function<void()> &&job)
+{
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.jobs.push_back(std::move(job));
+    worker.ready.notify_one();
+}
+
+/**
+ * Run a job on every worker and wait for all of them
+ * @param job Job to run with the worker's own state
+ */
+void Engine::run_all(const std::function<void(Worker &)> &job)
+{
+    std::vector<std::future<void>> pending;
+    for (auto &worker : workers_) {
+        auto promise = std::make_shared<std::promise<void>>();
+        pending.push_back(promise->get_future());
+
+        auto owner = worker.get();
+        auto task = &job;
+        post(*worker, [owner, task, promise]() {
+            (*task)(*owner);
+            promise->set_value();
+        });
+    }
+
+    for (auto &future : pending) {
+        future.wait();
+    }
+}
+
+/**
+ * Worker loop: apply queued jobs in order until stopped
+ * @param worker Worker to run
+ */
+void Engine::run(Worker &worker)
+{
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    while (true) {
+        worker.ready.wait(lock, [&worker]() { return worker.stopping || !worker.jobs.empty(); });
+        if (worker.jobs.empty()) {
+            // Stopping with nothing left to do
+            return;
+        }
+
+        auto job = std::move(worker.jobs.front());
+        worker.jobs.pop_front();
+        worker.busy = true;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        worker.busy = false;
+        if (worker.jobs.empty()) {
+            worker.idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef __ENGINE_H
+#define __ENGINE_H
+
+#include "session.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Host for many independent tables in one process
+ *
+ * Each table is owned by exactly one worker, picked by hashing its id, and
+ * only that worker ever touches it. Commands for a table therefore run in
+ * submission order without any locking beyond the worker's queue.
+ */
+class Engine {
+public:
+    // Called on the worker thread once a command has been applied
+    using Callback = std::function<void(const std::string &table,
+                                        Session::Outcome outcome,
+                                        const std::string &output)>;
+
+    // Totals for one player across every table they sat at
+    struct Standing {
+        std::string player;
+        long long total = 0;
+        std::size_t tables = 0;
+        std::size_t rounds = 0;
+    };
+
+    explicit Engine(std::size_t workers = 0);
+    ~Engine();
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    void submit(const std::string &table, const std::string &line, Callback done = nullptr);
+    void drain();
+    std::size_t table_count();
+    std::vector<Standing> standings();
+
+private:
+    struct Table {
+        Session session;
+        std::ostringstream output;
+
+        Table();
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable idle;
+        std::deque<std::function<void()>> jobs;
+        bool busy = false;
+        bool stopping = false;
+        std::unordered_map<std::string, std::unique_ptr<Table>> tables;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    Worker &worker_for(const std::string &table);
+    void post(Worker &worker, std::function<void()> &&job);
+    void run_all(const std::function<void(Worker &)> &job);
+    static void run(Worker &worker);
+};
+
+#endif // __ENGINE_H
@@ -0,0 +1,169 @@
+#include "exporter.h"
+#include "metrics.h"
+#include "session_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+/**
+ * Constructor for exporter
+ * @param workers Number of exports that can run at once (0 for one per core)
+ */
+Exporter::Exporter(std::size_t workers)
+{
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < workers; ++i) {
+        threads_.emplace_back([this]() { run(); });
+    }
+}
+
+/**
+ * Finish queued exports and stop the workers
+ */
+Exporter::~Exporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        ready_.notify_all();
+    }
+
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+/**
+ * Queue an export of the game as it is now
+ * @param game Game to export; copied before returning, without the undo
+ *             history unless it is needed
+ * @param format File format to write
+ * @return Name of the file that will be written
+ */
+const std::string Exporter::submit(const PureHonours &game, Format format)
+{
+    Job job;
+    job.game = game.copy(format == Format::Session);
+    job.format = format;
+    job.filename = game.export_filename() + (format == Format::Csv ? ".csv" : ".phs");
+    job.submitted = std::chrono::steady_clock::now();
+
+    const auto filename = job.filename;
+    std::lock_guard<std::mutex> lock(mutex_);
+    job.id = ++next_id_;
+    jobs_.push_back(std::move(job));
+    ready_.notify_one();
+
+    return filename;
+}
+
+/**
+ * Take the messages of exports finished since the last call
+ * @return One line per finished export, oldest first
+ */
+std::vector<std::string> Exporter::finished()
+{
+    std::vector<std::string> messages;
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages.swap(finished_);
+
+    return messages;
+}
+
+/**
+ * Count exports queued or being written
+ * @return Number of exports not yet finished
+ */
+std::size_t Exporter::pending()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + busy_;
+}
+
+/**
+ * Wait until every export submitted so far has finished
+ */
+void Exporter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return jobs_.empty() && busy_ == 0; });
+}
+
+/**
+ * Worker loop: write queued exports until stopped and the queue is empty
+ */
+void Exporter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        ready_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            break;
+        }
+
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        ++busy_;
+        lock.unlock();
+
+        const auto temp_name = job.filename + "." + std::to_string(job.id) + ".tmp";
+        bool written = write(job, temp_name);
+
+        // Exports of one game within the same second share a name; keep the newest
+        lock.lock();
+        auto &newest = renamed_[job.filename];
+        const bool superseded = newest > job.id;
+        if (written && !superseded) {
+            newest = job.id;
+            written = std::rename(temp_name.c_str(), job.filename.c_str()) == 0;
+        }
+        lock.unlock();
+
+        if (!written || superseded) {
+            std::remove(temp_name.c_str());
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - job.submitted;
+        job.game.reset();
+
+        // A superseded export never reaches the file, so it is not reported as saved
+        std::ostringstream message;
+        if (written && superseded) {
+            message << "Replaced by a newer export: " << job.filename;
+        } else if (written) {
+            message << "Saved to: " << job.filename << " ("
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+                    << " ms)";
+        } else {
+            message << "Failed to write file: " << job.filename;
+        }
+
+        lock.lock();
+        finished_.push_back(message.str());
+        --busy_;
+        if (jobs_.empty() && busy_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+/**
+ * Write one export to a temporary file
+ * @param job Export to write
+ * @param temp_name Path to write to
+ * @return True if successful, false otherwise
+ */
+bool Exporter::write(const Job &job, const std::string &temp_name)
+{
+    METRICS_TIME(Export);
+
+    if (job.format == Format::Csv) {
+        return job.game->save_csv(temp_name);
+    }
+
+    return session_file::write(temp_name, *job.game);
+}
@@ -0,0 +1,70 @@
+#ifndef __EXPORTER_H
+#define __EXPORTER_H
+
+#include "purehonours.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Background writer for CSV and session file exports
+ *
+ * Each export works on its own copy of the game taken when it is
+ * submitted, so later commands never wait for the file and never change
+ * what it holds. Files are written under a temporary name and renamed into
+ * place, so exports of the same game running at once cannot interleave and
+ * the newest one always ends up in the file.
+ * Completion messages are collected for the caller to show when it suits.
+ */
+class Exporter {
+public:
+    enum class Format {
+        Csv,
+        Session,
+    };
+
+    explicit Exporter(std::size_t workers = 0);
+    ~Exporter();
+
+    Exporter(const Exporter &) = delete;
+    Exporter &operator=(const Exporter &) = delete;
+
+    const std::string submit(const PureHonours &game, Format format);
+    std::vector<std::string> finished();
+    std::size_t pending();
+    void wait();
+
+private:
+    struct Job {
+        std::shared_ptr<const PureHonours> game;
+        Format format;
+        std::string filename;
+        std::uint64_t id;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable idle_;
+    std::deque<Job> jobs_;
+    std::vector<std::string> finished_;
+    std::unordered_map<std::string, std::uint64_t> renamed_; // Newest export moved into place
+    std::size_t busy_ = 0;
+    std::uint64_t next_id_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void run();
+    static bool write(const Job &job, const std::string &temp_name);
+};
+
+#endif // __EXPORTER_H
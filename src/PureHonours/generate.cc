@@ -0,0 +1,175 @@
+#include "generate.h"
+#include "output_buffer.h"
+#include "purehonours.h"
+#include "simulate.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Names used for generated players
+const char *const NAMES[] = {"A", "B", "C", "D"};
+
+} // namespace
+
+namespace generate
+{
+
+/**
+ * Check generator settings
+ * @param config Generator settings
+ * @return True if a log can be generated from them, false otherwise
+ */
+bool valid(const Config &config)
+{
+    return config.players >= 2 && config.players <= 4 &&
+           config.self_draw >= 0 && config.gong_direct >= 0 &&
+           config.self_draw + config.gong_direct <= 1 &&
+           config.deletes >= 0 && config.deletes <= 1 &&
+           config.undos >= 0 && config.undos <= 1;
+}
+
+/**
+ * Write a synthetic session log
+ * @param config Generator settings; must be valid()
+ * @param out Stream to write the log to
+ * @return What the log holds
+ */
+Counts write(const Config &config, std::ostream &out)
+{
+    StreamSink sink(out);
+    OutputBuffer buffer(sink);
+    Counts counts;
+
+    // Player setup
+    const int players = config.players;
+    buffer.put_int(players);
+    buffer.put('\n');
+    for (int i = 0; i < players; ++i) {
+        buffer.put(NAMES[i]);
+        buffer.put('\n');
+    }
+    counts.lines += 1 + static_cast<std::size_t>(players);
+
+    // Fan table; a game holding it tells which hands score
+    PureHonours game(players, std::vector<std::string>(NAMES, NAMES + players));
+    game.set_output(nullptr);
+    if (config.fan_table.empty()) {
+        game.default_fans();
+        buffer.put("d\n", 2);
+        ++counts.lines;
+    } else {
+        for (auto &pair : config.fan_table) {
+            game.add_fan_score(pair.first, pair.second);
+            buffer.put_int(pair.first);
+            buffer.put(' ');
+            buffer.put_int(pair.second);
+            buffer.put('\n');
+        }
+        buffer.put('\n');
+        counts.lines += config.fan_table.size() + 1;
+    }
+
+    std::vector<int> fans;
+    std::vector<int> weights;
+    for (auto &pair : config.fan_weights.empty() ? simulate::default_fan_weights()
+                                                 : config.fan_weights) {
+        fans.push_back(pair.first);
+        weights.push_back(pair.second);
+    }
+
+    std::mt19937_64 rng(config.seed);
+    std::discrete_distribution<std::size_t> fan(weights.begin(), weights.end());
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<int> seat(0, players - 1);
+    std::uniform_int_distribution<int> other(1, players - 1);
+
+    // Changes that can be undone and redone, true for an add; only their
+    // effect on the number of live rounds matters here
+    std::vector<bool> undo;
+    std::vector<bool> redo;
+    std::size_t live = 0;
+
+    // The game forgets its oldest changes in batches; do the same
+    auto push_undo = [&undo, &redo](bool add) {
+        undo.push_back(add);
+        redo.clear();
+        if (undo.size() >= 2 * UNDO_DEPTH) {
+            undo.erase(undo.begin(), undo.end() - static_cast<std::ptrdiff_t>(UNDO_DEPTH));
+        }
+    };
+
+    for (; counts.hands < config.hands; ++counts.hands) {
+        const auto winner = seat(rng);
+        const auto loser = (winner + other(rng)) % players;
+        const double k = chance(rng);
+        const bool gong_direct = k < config.gong_direct;
+        const bool self_draw = gong_direct || k < config.gong_direct + config.self_draw;
+        const int won = fans[fan(rng)];
+
+        buffer.put("a ", 2);
+        buffer.put(NAMES[winner]);
+        buffer.put(' ');
+        buffer.put_int(won);
+        if (gong_direct) {
+            buffer.put(" selfg ", 7);
+            buffer.put(NAMES[loser]);
+        } else if (self_draw) {
+            buffer.put(" self", 5);
+        } else {
+            buffer.put(' ');
+            buffer.put(NAMES[loser]);
+        }
+        buffer.put('\n');
+        ++counts.lines;
+
+        // Hands below the table's minimum are accepted but add no round
+        if (game.fan_score(won, self_draw) != 0) {
+            ++live;
+            push_undo(true);
+        }
+
+        // Delete the last round or one picked at random
+        if (live > 0 && chance(rng) < config.deletes) {
+            if (chance(rng) < 0.5) {
+                buffer.put("d\n", 2);
+            } else {
+                buffer.put("d ", 2);
+                buffer.put_int(static_cast<long long>(
+                    std::uniform_int_distribution<std::size_t>(1, live)(rng)));
+                buffer.put('\n');
+            }
+            --live;
+            push_undo(false);
+            ++counts.lines;
+            ++counts.deletes;
+        }
+
+        if (!undo.empty() && chance(rng) < config.undos) {
+            live = undo.back() ? live - 1 : live + 1;
+            redo.push_back(undo.back());
+            undo.pop_back();
+            buffer.put("u\n", 2);
+            ++counts.lines;
+            ++counts.undos;
+        }
+
+        if (!redo.empty() && chance(rng) < config.undos) {
+            live = redo.back() ? live + 1 : live - 1;
+            undo.push_back(redo.back());
+            redo.pop_back();
+            buffer.put("r\n", 2);
+            ++counts.lines;
+            ++counts.redos;
+        }
+    }
+
+    buffer.flush();
+    counts.rounds = live;
+    return counts;
+}
+
+} // namespace generate
@@ -0,0 +1,46 @@
+#ifndef __GENERATE_H
+#define __GENERATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+
+// Synthetic command logs for load testing and long-session checks
+//
+// A log is a complete session in the history grammar: player setup, the
+// fan table, then hands with deletions, undos and redos mixed in. Every
+// command is valid when it is reached, so replaying a log never rejects a
+// line. The same settings and seed always give the same log.
+namespace generate
+{
+
+struct Config {
+    int players = 4;
+    std::size_t hands = 1000;
+    double self_draw = 0.25;        // Share of hands won by plain self-draw
+    double gong_direct = 0.05;      // Share of hands won by self-draw off a gong
+    double deletes = 0.02;          // Chance of deleting a round after each hand
+    double undos = 0.01;            // Chance of an undo, and again of a redo, after each hand
+    std::map<int, int> fan_weights; // Relative frequency of each fan, empty for defaults
+    std::map<int, int> fan_table;   // Fan/score table, empty for the defaults
+    std::uint64_t seed = 1;
+};
+
+// What a log holds
+struct Counts {
+    std::size_t lines = 0;
+    std::size_t hands = 0;
+    std::size_t deletes = 0;
+    std::size_t undos = 0;
+    std::size_t redos = 0;
+    std::size_t rounds = 0; // Live rounds once the log has been replayed
+};
+
+bool valid(const Config &config);
+
+Counts write(const Config &config, std::ostream &out);
+
+} // namespace generate
+
+#endif // __GENERATE_H
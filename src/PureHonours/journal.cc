@@ -0,0 +1,244 @@
+#include "journal.h"
+#include "metrics.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Constructor for journal
+ * @param durability Sync policy for appended records
+ * @param group_records Records per group commit (Durability::Group only)
+ * @param group_interval Maximum time between group commits (Durability::Group only)
+ */
+Journal::Journal(Durability durability,
+                 std::size_t group_records,
+                 std::chrono::milliseconds group_interval)
+: durability_(durability),
+  group_records_(group_records == 0 ? 1 : group_records),
+  group_interval_(group_interval),
+  fd_(-1),
+  offset_(0),
+  unsynced_(0),
+  last_sync_(std::chrono::steady_clock::now())
+{
+}
+
+Journal::~Journal()
+{
+    close();
+}
+
+/**
+ * Open a journal file for appending
+ * @param filename Path of the journal
+ * @param truncate Whether to discard existing records
+ * @return True if successful, false otherwise
+ */
+bool Journal::open(const std::string &filename, bool truncate)
+{
+    close();
+
+    int flags = O_RDWR | O_CREAT | O_APPEND;
+    if (truncate) {
+        flags |= O_TRUNC;
+    }
+
+    fd_ = ::open(filename.c_str(), flags, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    if (truncate) {
+        METRICS_ADD(JournalRewrites, 1);
+    }
+
+    if (!truncate && !trim_torn_tail()) {
+        close();
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        close();
+        return false;
+    }
+    offset_ = st.st_size;
+
+    unsynced_ = 0;
+    last_sync_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+/**
+ * Append a record as one line
+ * @param record Record to append (must not contain a newline)
+ * @return True if the whole record was written, false otherwise
+ */
+bool Journal::append(const std::string &record)
+{
+    if (fd_ < 0) {
+        return false;
+    }
+
+    METRICS_TIME(JournalAppend);
+
+    // Reuse the buffer so appends do not allocate once warmed up
+    buffer_.assign(record);
+    buffer_.push_back('\n');
+
+    const char *data = buffer_.data();
+    std::size_t remaining = buffer_.size();
+    while (remaining > 0) {
+        auto written = ::write(fd_, data, remaining);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            // Cut off whatever part of the record made it out
+            if (::ftruncate(fd_, offset_) != 0) {
+                close();
+            }
+            return false;
+        }
+
+        data += written;
+        remaining -= static_cast<std::size_t>(written);
+    }
+    offset_ += static_cast<long long>(buffer_.size());
+    ++unsynced_;
+    METRICS_ADD(JournalAppends, 1);
+    METRICS_ADD(BytesWritten, buffer_.size());
+
+    switch (durability_) {
+    case Durability::Always:
+        return sync();
+    case Durability::Group:
+        if (unsynced_ >= group_records_ ||
+            std::chrono::steady_clock::now() - last_sync_ >= group_interval_) {
+            return sync();
+        }
+        return true;
+    case Durability::None:
+        return true;
+    }
+
+    return true;
+}
+
+/**
+ * Force all appended records to stable storage
+ * @return True if successful, false otherwise
+ */
+bool Journal::sync()
+{
+    if (fd_ < 0) {
+        return false;
+    }
+
+    last_sync_ = std::chrono::steady_clock::now();
+    if (unsynced_ == 0) {
+        return true;
+    }
+
+    // Records stay outstanding after a failure so the next sync retries them
+    METRICS_TIME(JournalSync);
+    if (::fdatasync(fd_) != 0) {
+        return false;
+    }
+
+    unsynced_ = 0;
+    return true;
+}
+
+/**
+ * Sync a group whose interval has run out, for callers that go idle
+ *
+ * A group commit is otherwise only checked when the next record arrives,
+ * so records appended just before a pause would wait for the next command.
+ * @return When to call again; time_point::max() if no records are waiting
+ */
+std::chrono::steady_clock::time_point Journal::sync_due()
+{
+    using clock = std::chrono::steady_clock;
+
+    if (fd_ < 0 || durability_ != Durability::Group || unsynced_ == 0) {
+        return clock::time_point::max();
+    }
+
+    const auto deadline = last_sync_ + group_interval_;
+    if (clock::now() < deadline) {
+        return deadline;
+    }
+
+    sync();
+    return clock::time_point::max();
+}
+
+/**
+ * Sync outstanding records and close the file
+ */
+void Journal::close()
+{
+    if (fd_ < 0) {
+        return;
+    }
+
+    if (durability_ != Durability::None) {
+        sync();
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+/**
+ * Check whether a journal file is open
+ * @return True if open, false otherwise
+ */
+bool Journal::is_open() const
+{
+    return fd_ >= 0;
+}
+
+/**
+ * Get size of the journal
+ * @return Bytes of complete records in the file
+ */
+long long Journal::offset() const
+{
+    return offset_;
+}
+
+/**
+ * Drop a partial final line left behind by a crash mid-append
+ * @return True if successful, false otherwise
+ */
+bool Journal::trim_torn_tail()
+{
+    auto end = ::lseek(fd_, 0, SEEK_END);
+    if (end <= 0) {
+        return end == 0;
+    }
+
+    // Walk backwards to the last newline
+    char block[4096];
+    auto pos = end;
+    while (pos > 0) {
+        auto chunk = pos < static_cast<off_t>(sizeof(block)) ? pos : static_cast<off_t>(sizeof(block));
+        pos -= chunk;
+        if (::pread(fd_, block, static_cast<std::size_t>(chunk), pos) != chunk) {
+            return false;
+        }
+
+        for (auto i = chunk; i > 0; --i) {
+            if (block[i - 1] == '\n') {
+                auto keep = pos + i;
+                return keep == end || ::ftruncate(fd_, keep) == 0;
+            }
+        }
+    }
+
+    // No complete record at all
+    return ::ftruncate(fd_, 0) == 0;
+}
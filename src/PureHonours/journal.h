@@ -0,0 +1,58 @@
+#ifndef __JOURNAL_H
+#define __JOURNAL_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * When appended records are forced to stable storage
+ */
+enum class Durability {
+    Always, // fsync after every record
+    Group,  // fsync once every N records or T milliseconds
+    None,   // leave write-back to the OS
+};
+
+/**
+ * Append-only command journal
+ *
+ * Every record is a single line appended to a file opened with O_APPEND,
+ * with write() repeated until the whole line is out. A write that fails
+ * part-way is truncated back off, and a torn final line left by a crash is
+ * trimmed when the journal is reopened, so readers only ever see whole
+ * records.
+ */
+class Journal {
+public:
+    Journal(Durability durability = Durability::Group,
+            std::size_t group_records = 16,
+            std::chrono::milliseconds group_interval = std::chrono::milliseconds(200));
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    bool open(const std::string &filename, bool truncate);
+    bool append(const std::string &record);
+    bool sync();
+    std::chrono::steady_clock::time_point sync_due();
+    void close();
+    bool is_open() const;
+    long long offset() const;
+
+private:
+    Durability durability_;
+    std::size_t group_records_;
+    std::chrono::milliseconds group_interval_;
+
+    int fd_;
+    long long offset_;
+    std::size_t unsynced_;
+    std::chrono::steady_clock::time_point last_sync_;
+    std::string buffer_;
+
+    bool trim_torn_tail();
+};
+
+#endif // __JOURNAL_H
@@ -0,0 +1,520 @@
+#include "league.h"
+#include "purehonours.h"
+#include "session.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+
+using Table = std::unordered_map<std::string, league::Entry>;
+
+/**
+ * Check a filename's extension
+ * @param name Filename
+ * @param extension Extension including the dot
+ * @return True if name ends with extension, false otherwise
+ */
+bool has_extension(const std::string &name, const std::string &extension)
+{
+    return name.size() > extension.size() &&
+           name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/**
+ * Add one session's results for a player
+ * @param table Table to add to
+ * @param player Player initials
+ * @param total Score for the session
+ * @param rounds Rounds played in the session
+ * @param rounds_won Rounds won in the session
+ */
+void add_game(Table &table,
+              const std::string &player,
+              long long total,
+              std::size_t rounds,
+              std::size_t rounds_won)
+{
+    auto &entry = table[player];
+    entry.player = player;
+    entry.total += total;
+    entry.rounds += rounds;
+    entry.rounds_won += rounds_won;
+    ++entry.games;
+}
+
+/**
+ * Replay a history file through the scoring rules
+ * @param filename Path of the history file
+ * @param table Table to add to
+ * @return True if successful, false otherwise
+ */
+bool add_history(const std::string &filename, Table &table)
+{
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    Session session(nullptr);
+    session.replay(in);
+    auto game = session.game();
+    if (!game) {
+        return false;
+    }
+
+    const auto &names = game->player_names();
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        add_game(table,
+                 names[i],
+                 game->totals()[i],
+                 game->round_count(),
+                 game->statistics().player(i).wins);
+    }
+
+    return true;
+}
+
+/**
+ * Split a CSV line on commas
+ * @param line Line to split
+ * @param fields Cleared and filled with the fields
+ */
+void split_csv(const std::string &line, std::vector<std::string> &fields)
+{
+    fields.clear();
+    std::size_t start = 0;
+    while (true) {
+        auto end = line.find(',', start);
+        if (end == std::string::npos) {
+            fields.push_back(line.substr(start));
+            return;
+        }
+
+        fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+/**
+ * One round read back from a CSV report
+ */
+struct CsvRound {
+    std::size_t winner;
+    std::size_t loser;
+    int fan;
+    bool self_draw;
+    bool gong_direct;
+    int score; // Score for the fan, per loser if a self-draw
+};
+
+/**
+ * Find a player by initials
+ * @param names Player initials in seat order
+ * @param name Initials to find, ignoring any trailing full stop
+ * @return Seat of the player; the number of players if not found
+ */
+std::size_t find_player(const std::vector<std::string> &names, std::string name)
+{
+    if (!name.empty() && name.back() == '.') {
+        name.pop_back();
+    }
+
+    return std::find(names.begin(), names.end(), name) - names.begin();
+}
+
+/**
+ * Parse a number in brackets, such as "(32" or "(32)."
+ * @param word Word to parse
+ * @param value Set to the number
+ * @return True if successful, false otherwise
+ */
+bool bracketed(const std::string &word, int &value)
+{
+    char *end = nullptr;
+    if (word.size() < 2 || word[0] != '(') {
+        return false;
+    }
+
+    value = static_cast<int>(std::strtol(word.c_str() + 1, &end, 10));
+    return end != word.c_str() + 1;
+}
+
+/**
+ * Read a round back from its note and score changes
+ *
+ * The note gives the winner, fan and kind of win. A win fed by a direct gong
+ * reads like any other fed win, so it is told apart by the loser paying for
+ * the whole table.
+ * @param note Notes column of the row
+ * @param names Player initials in seat order
+ * @param row Score change for each player
+ * @param round Filled with the round
+ * @return True if successful, false otherwise
+ */
+bool parse_round(const std::string &note,
+                 const std::vector<std::string> &names,
+                 const std::vector<int> &row,
+                 CsvRound &round)
+{
+    std::istringstream in(note);
+    std::vector<std::string> words;
+    std::string word;
+    while (in >> word) {
+        words.push_back(word);
+    }
+
+    const int others = static_cast<int>(names.size()) - 1;
+    if (words.size() < 6 || words[1] != "wins" || words[3] != "fan") {
+        return false;
+    }
+
+    char *end = nullptr;
+    round.winner = find_player(names, words[0]);
+    round.fan = static_cast<int>(std::strtol(words[2].c_str(), &end, 10));
+    if (round.winner == names.size() || *end != '\0' || round.fan < 0) {
+        return false;
+    }
+
+    if (words[4] == "from" && words.size() == 7) {
+        // W wins F fan from L (S).
+        round.self_draw = false;
+        round.loser = find_player(names, words[5]);
+        if (round.loser == names.size() || !bracketed(words[6], round.score)) {
+            return false;
+        }
+        round.gong_direct = others > 1 && row[round.loser] == -round.score * others;
+    } else if (words[4] == "by" && words.size() == 10 && words[9] == "all).") {
+        // W wins F fan by self draw (S from all).
+        round.self_draw = true;
+        round.gong_direct = false;
+        round.loser = 0;
+        if (!bracketed(words[7], round.score)) {
+            return false;
+        }
+    } else if (words[4] == "by" && words.size() == 13 && words[11] == "from") {
+        // W wins F fan by self draw (S) off a gong from L.
+        round.self_draw = true;
+        round.gong_direct = true;
+        round.loser = find_player(names, words[12]);
+        if (round.loser == names.size() || !bracketed(words[7], round.score)) {
+            return false;
+        }
+        round.score /= others;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Work out the fan/score pairs a report was scored with
+ * @param rounds Rounds of the report
+ * @param player_count Number of players
+ * @param scores Filled with the score for each fan seen
+ * @return True if the rounds agree on every fan, false otherwise
+ */
+bool fan_scores(const std::vector<CsvRound> &rounds, int player_count, std::map<int, int> &scores)
+{
+    // Fed wins give the score directly
+    for (auto &round : rounds) {
+        if (!round.self_draw) {
+            auto it = scores.emplace(round.fan, round.score).first;
+            if (it->second != round.score) {
+                return false;
+            }
+        }
+    }
+
+    // Self-draws give a share of 150% rounded down, so find a score that matches
+    for (auto &round : rounds) {
+        if (!round.self_draw || scores.count(round.fan) != 0) {
+            continue;
+        }
+
+        const int guess = round.score * (player_count - 1) * 2 / 3;
+        for (int score = std::max(1, guess - 2); score <= guess + 2; ++score) {
+            if (score * 3 / 2 / (player_count - 1) == round.score) {
+                scores[round.fan] = score;
+                break;
+            }
+        }
+
+        if (scores.count(round.fan) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Replay an exported CSV report through the scoring rules
+ *
+ * Each row's note is turned back into a round and the fan/score pairs are
+ * worked out from the scores it quotes. The replayed totals must match the
+ * report's own score columns, or the file is treated as unreadable.
+ * @param filename Path of the CSV file
+ * @param table Table to add to
+ * @return True if successful, false otherwise
+ */
+bool add_csv(const std::string &filename, Table &table)
+{
+    std::ifstream in(filename);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line)) {
+        return false;
+    }
+
+    // Title row is Round, one column per player, then Notes
+    std::vector<std::string> fields;
+    split_csv(line, fields);
+    if (fields.size() < 4 || fields.size() > MAX_PLAYERS + 2 || fields[0] != "Round") {
+        return false;
+    }
+
+    std::vector<std::string> names(fields.begin() + 1, fields.end() - 1);
+    std::vector<long long> totals(names.size(), 0);
+    std::vector<CsvRound> rounds;
+    std::vector<int> row(names.size());
+
+    while (std::getline(in, line)) {
+        split_csv(line, fields);
+
+        // Skip anything that is not a numbered round, such as a Sum row
+        char *end = nullptr;
+        std::strtol(fields[0].c_str(), &end, 10);
+        if (fields[0].empty() || *end != '\0') {
+            continue;
+        }
+
+        if (fields.size() != names.size() + 2) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            row[i] = static_cast<int>(std::strtol(fields[i + 1].c_str(), nullptr, 10));
+            totals[i] += row[i];
+        }
+
+        CsvRound round;
+        if (!parse_round(fields.back(), names, row, round)) {
+            return false;
+        }
+        rounds.push_back(round);
+    }
+
+    std::map<int, int> scores;
+    const int player_count = static_cast<int>(names.size());
+    if (!fan_scores(rounds, player_count, scores)) {
+        return false;
+    }
+
+    auto names_copy = names;
+    PureHonours game(player_count, std::move(names_copy));
+    game.set_output(nullptr);
+    for (auto &pair : scores) {
+        game.add_fan_score(pair.first, pair.second);
+    }
+
+    for (auto &round : rounds) {
+        game.add_result(round.winner, round.fan, round.self_draw, round.loser, round.gong_direct);
+    }
+
+    // Every round must have scored exactly as the report says
+    if (game.round_count() != rounds.size()) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (game.totals()[i] != totals[i]) {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        add_game(table,
+                 names[i],
+                 game.totals()[i],
+                 game.round_count(),
+                 game.statistics().player(i).wins);
+    }
+
+    return true;
+}
+
+/**
+ * Recursively collect session files below a directory
+ *
+ * Exporting writes a new CSV report beside the history file after almost
+ * every hand, so a directory with history files has its CSV reports left out
+ * and each session counts once. Symbolic links to directories are not
+ * followed, so a link back up the tree cannot loop.
+ * @param directory Directory to scan
+ * @param files Paths are appended here
+ */
+void scan(const std::string &directory, std::vector<std::string> &files)
+{
+    auto dir = ::opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+
+    std::vector<std::string> reports;
+    bool history = false;
+    while (auto entry = ::readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        const auto path = directory + "/" + name;
+        struct stat st;
+        if (::lstat(path.c_str(), &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            scan(path, files);
+        } else if (S_ISLNK(st.st_mode) && (::stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode))) {
+            continue;
+        } else if (has_extension(name, ".purehonours")) {
+            files.push_back(path);
+            history = true;
+        } else if (has_extension(name, ".csv")) {
+            reports.push_back(path);
+        }
+    }
+
+    ::closedir(dir);
+
+    if (!history) {
+        files.insert(files.end(), reports.begin(), reports.end());
+    }
+}
+
+} // namespace
+
+namespace league
+{
+
+/**
+ * Find history and CSV files in a directory tree
+ *
+ * CSV reports are only taken from directories without history files.
+ * @param directory Root of the tree
+ * @return Paths of matching files, sorted
+ */
+std::vector<std::string> find_files(const std::string &directory)
+{
+    std::vector<std::string> files;
+    scan(directory, files);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+/**
+ * Replay session files in parallel and merge the results
+ * @param files History (.purehonours) and CSV report files; each counts as one game,
+ *              and CSV reports are replayed from their notes
+ * @param threads Number of threads (0 for one per core)
+ * @return League table, highest total first
+ */
+Summary aggregate(const std::vector<std::string> &files, std::size_t threads)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<std::size_t>(1, std::min(threads, files.size()));
+
+    // Map: each thread takes files off a shared counter into its own table
+    std::atomic<std::size_t> next(0);
+    std::atomic<std::size_t> failed(0);
+    std::vector<Table> tables(threads);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&files, &next, &failed, &tables, t]() {
+            std::size_t i;
+            while ((i = next++) < files.size()) {
+                const auto &file = files[i];
+                bool ok = has_extension(file, ".csv") ? add_csv(file, tables[t])
+                                                      : add_history(file, tables[t]);
+                if (!ok) {
+                    ++failed;
+                }
+            }
+        });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // Reduce: merge the per-thread tables
+    Table merged;
+    for (auto &table : tables) {
+        for (auto &pair : table) {
+            auto &entry = merged[pair.first];
+            entry.player = pair.first;
+            entry.total += pair.second.total;
+            entry.games += pair.second.games;
+            entry.rounds += pair.second.rounds;
+            entry.rounds_won += pair.second.rounds_won;
+        }
+    }
+
+    Summary summary;
+    summary.files = files.size();
+    summary.failed = failed;
+    for (auto &pair : merged) {
+        summary.table.push_back(pair.second);
+    }
+
+    std::sort(summary.table.begin(), summary.table.end(), [](const Entry &a, const Entry &b) {
+        return a.total != b.total ? a.total > b.total : a.player < b.player;
+    });
+
+    return summary;
+}
+
+/**
+ * Print a league table
+ * @param summary League to print
+ * @param out Stream to print to
+ */
+void print(const Summary &summary, std::ostream &out)
+{
+    out << std::left << std::setw(10) << "Player" << std::right
+        << std::setw(8) << "Games"
+        << std::setw(10) << "Rounds"
+        << std::setw(8) << "Won"
+        << std::setw(12) << "Total" << '\n';
+
+    for (auto &entry : summary.table) {
+        out << std::left << std::setw(10) << entry.player << std::right
+            << std::setw(8) << entry.games
+            << std::setw(10) << entry.rounds
+            << std::setw(8) << entry.rounds_won
+            << std::setw(12) << entry.total << '\n';
+    }
+
+    out << summary.files << " files";
+    if (summary.failed > 0) {
+        out << " (" << summary.failed << " unreadable)";
+    }
+    out << std::endl;
+}
+
+} // namespace league
@@ -0,0 +1,36 @@
+#ifndef __LEAGUE_H
+#define __LEAGUE_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Season standings built from a directory tree of session files
+namespace league
+{
+
+// One player's season line
+struct Entry {
+    std::string player;
+    long long total = 0;
+    std::size_t games = 0;
+    std::size_t rounds = 0;
+    std::size_t rounds_won = 0;
+};
+
+struct Summary {
+    std::vector<Entry> table;
+    std::size_t files = 0;
+    std::size_t failed = 0;
+};
+
+std::vector<std::string> find_files(const std::string &directory);
+
+Summary aggregate(const std::vector<std::string> &files, std::size_t threads = 0);
+
+void print(const Summary &summary, std::ostream &out);
+
+} // namespace league
+
+#endif // __LEAGUE_H
@@ -0,0 +1,126 @@
+#include "live_index.h"
+
+namespace
+{
+
+/**
+ * Get lowest set bit
+ * @param i Tree index
+ * @return Lowest set bit of i
+ */
+std::size_t lowbit(std::size_t i)
+{
+    return i & (~i + 1);
+}
+
+} // namespace
+
+/**
+ * Remove every entry
+ */
+void LiveIndex::clear()
+{
+    tree_.assign(1, 0);
+    live_.clear();
+    count_ = 0;
+}
+
+/**
+ * Append an entry
+ * @param live Whether the entry is live
+ */
+void LiveIndex::push_back(bool live)
+{
+    // Sum the subtrees that the new node covers
+    const std::size_t n = tree_.size();
+    std::uint32_t sum = live ? 1 : 0;
+    for (std::size_t j = n - 1; j > n - lowbit(n); j -= lowbit(j)) {
+        sum += tree_[j];
+    }
+
+    tree_.push_back(sum);
+    live_.push_back(live);
+    count_ += live ? 1 : 0;
+}
+
+/**
+ * Mark an entry live or dead
+ * @param position Index of the entry (0-based)
+ * @param live Whether the entry is live
+ */
+void LiveIndex::set(std::size_t position, bool live)
+{
+    if (live_[position] == live) {
+        return;
+    }
+
+    live_[position] = live;
+    if (live) {
+        ++count_;
+        for (std::size_t i = position + 1; i < tree_.size(); i += lowbit(i)) {
+            ++tree_[i];
+        }
+    } else {
+        --count_;
+        for (std::size_t i = position + 1; i < tree_.size(); i += lowbit(i)) {
+            --tree_[i];
+        }
+    }
+}
+
+/**
+ * Get number of entries, live or dead
+ * @return Number of entries
+ */
+std::size_t LiveIndex::size() const
+{
+    return live_.size();
+}
+
+/**
+ * Get number of live entries
+ * @return Number of live entries
+ */
+std::size_t LiveIndex::count() const
+{
+    return count_;
+}
+
+/**
+ * Find the n-th live entry
+ * @param nth Live entry to find (1-based, at most count())
+ * @return Index of the entry (0-based)
+ */
+std::size_t LiveIndex::select(std::size_t nth) const
+{
+    std::size_t step = 1;
+    while (step * 2 < tree_.size()) {
+        step *= 2;
+    }
+
+    // Descend from the largest power of two, skipping whole subtrees
+    std::size_t position = 0;
+    for (; step > 0; step /= 2) {
+        if (position + step < tree_.size() && tree_[position + step] < nth) {
+            position += step;
+            nth -= tree_[position];
+        }
+    }
+
+    return position;
+}
+
+/**
+ * Count live entries before a position
+ * @param position Index of the entry (0-based, at most size())
+ * @return Number of live entries before it
+ */
+std::size_t LiveIndex::rank(std::size_t position) const
+{
+    std::size_t count = 0;
+    for (std::size_t i = position; i > 0; i -= lowbit(i)) {
+        count += tree_[i];
+    }
+
+    return count;
+}
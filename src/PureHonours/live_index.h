@@ -0,0 +1,32 @@
+#ifndef __LIVE_INDEX_H
+#define __LIVE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Positions of live entries in a list that keeps tombstones
+ *
+ * A Fenwick tree over one live bit per entry, so marking an entry live or
+ * dead and finding the n-th live entry both take O(log n).
+ */
+class LiveIndex {
+public:
+    void clear();
+    void push_back(bool live);
+    void set(std::size_t position, bool live);
+
+    std::size_t size() const;
+    std::size_t count() const;
+    std::size_t select(std::size_t nth) const;
+    std::size_t rank(std::size_t position) const;
+
+private:
+    // tree_[i] counts live entries in (i - lowbit(i), i]; tree_[0] is unused
+    std::vector<std::uint32_t> tree_ = std::vector<std::uint32_t>(1, 0);
+    std::vector<bool> live_;
+    std::size_t count_ = 0;
+};
+
+#endif // __LIVE_INDEX_H
@@ -1,238 +1,646 @@
+#include "PureHonours/archive.h"
+#include "PureHonours/batch.h"
+#include "PureHonours/client.h"
+#include "PureHonours/core.h"
+#include "PureHonours/engine.h"
+#include "PureHonours/exporter.h"
+#include "PureHonours/generate.h"
+#include "PureHonours/journal.h"
+#include "PureHonours/league.h"
+#include "PureHonours/metrics.h"
 #include "PureHonours/purehonours.h"
+#include "PureHonours/server.h"
+#include "PureHonours/session.h"
+#include "PureHonours/session_file.h"
+#include "PureHonours/simulate.h"
+#include "PureHonours/snapshot.h"
 #include "ShoddyRepl/shoddy.h"
 
-#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <exception>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace
 {
 
-void write_history(const std::string &filename,
-                   const std::vector<std::string> &commands)
+// Command-line options
+struct Options {
+    Durability durability = Durability::Group;
+    std::size_t group_records = 16;
+    long group_ms = 200;
+    std::size_t snapshot_every = 1000;
+    std::string resume;
+    std::string convert;
+    std::string batch;
+    batch::Report report = batch::Report::Scores;
+    std::string tables;
+    std::size_t workers = 0;
+    std::string league;
+    simulate::Config simulate;
+    bool generate_log = false;
+    generate::Config generate;
+    std::string serve;
+    std::string connect;
+    std::size_t clients = 1;
+    std::string follow;
+    std::string metrics_file;
+    std::string archive;
+    std::vector<std::string> archive_add;
+    bool archive_query = false;
+    archive::Query query;
+};
+
+/**
+ * Writes the metrics report when main returns
+ */
+struct MetricsDump {
+    std::string filename;
+
+    ~MetricsDump()
+    {
+        if (!filename.empty() && !metrics::dump(filename)) {
+            std::cerr << "Failed to write metrics to: " << filename << std::endl;
+        }
+    }
+};
+
+/**
+ * Parse command-line options
+ * @param argc Argument count
+ * @param argv Arguments
+ * @param options Options to fill in
+ * @return True if successful, false otherwise
+ */
+bool parse_options(int argc, char *argv[], Options &options)
 {
-    try {
-        auto file = std::ofstream(filename, std::ios_base::out | std::ios_base::trunc);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file for writing: " << filename << std::endl;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for option: " << arg << std::endl;
+            return false;
         }
 
-        for (auto &cmd : commands) {
-            file << cmd << std::endl;
+        const std::string value = argv[++i];
+        try {
+            if (arg == "--sync" && value == "always") {
+                options.durability = Durability::Always;
+            } else if (arg == "--sync" && value == "group") {
+                options.durability = Durability::Group;
+            } else if (arg == "--sync" && value == "none") {
+                options.durability = Durability::None;
+            } else if (arg == "--sync-records") {
+                options.group_records = std::stoul(value);
+            } else if (arg == "--sync-ms") {
+                options.group_ms = std::stol(value);
+                if (options.group_ms < 0) {
+                    std::cerr << "Invalid value for option: " << arg << std::endl;
+                    return false;
+                }
+            } else if (arg == "--snapshot-every") {
+                options.snapshot_every = std::stoul(value);
+            } else if (arg == "--metrics-file") {
+                options.metrics_file = value;
+            } else if (arg == "--follow") {
+                options.follow = value;
+            } else if (arg == "--resume") {
+                options.resume = value;
+            } else if (arg == "--convert") {
+                options.convert = value;
+            } else if (arg == "--batch") {
+                options.batch = value;
+            } else if (arg == "--tables") {
+                options.tables = value;
+            } else if (arg == "--league") {
+                options.league = value;
+            } else if (arg == "--archive") {
+                options.archive = value;
+            } else if (arg == "--archive-add") {
+                options.archive_add.push_back(value);
+            } else if (arg == "--query") {
+                options.archive_query = true;
+                if (!archive::parse_query(value, options.query)) {
+                    std::cerr << "Invalid query: " << value << std::endl;
+                    return false;
+                }
+            } else if (arg == "--workers") {
+                options.workers = std::stoul(value);
+            } else if (arg == "--serve") {
+                options.serve = value;
+            } else if (arg == "--connect") {
+                options.connect = value;
+            } else if (arg == "--clients") {
+                options.clients = std::stoul(value);
+            } else if (arg == "--simulate") {
+                options.simulate.sessions = std::stoul(value);
+            } else if (arg == "--sim-players") {
+                options.simulate.players = std::stoi(value);
+            } else if (arg == "--sim-rounds") {
+                options.simulate.rounds = std::stoul(value);
+            } else if (arg == "--self-draw") {
+                options.simulate.self_draw = std::stod(value);
+            } else if (arg == "--gong-direct") {
+                options.simulate.gong_direct = std::stod(value);
+            } else if (arg == "--generate") {
+                options.generate_log = true;
+                options.generate.hands = std::stoul(value);
+            } else if (arg == "--delete-rate") {
+                options.generate.deletes = std::stod(value);
+            } else if (arg == "--undo-rate") {
+                options.generate.undos = std::stod(value);
+            } else if (arg == "--bust") {
+                options.simulate.bust = std::stoll(value);
+            } else if (arg == "--seed") {
+                options.simulate.seed = std::stoull(value);
+            } else if (arg == "--fan-weights" || arg == "--fan-table") {
+                auto &pairs = arg == "--fan-weights" ? options.simulate.fan_weights
+                                                     : options.simulate.fan_table;
+                if (!simulate::parse_pairs(value, pairs)) {
+                    std::cerr << "Invalid fan list: " << value << std::endl;
+                    return false;
+                }
+            } else if (arg == "--report") {
+                if (!batch::parse_report(value, options.report)) {
+                    std::cerr << "Invalid report: " << value << std::endl;
+                    return false;
+                }
+            } else {
+                std::cerr << "Invalid option: " << arg << " " << value << std::endl;
+                return false;
+            }
+        } catch (std::exception &) {
+            std::cerr << "Invalid value for option: " << arg << std::endl;
+            return false;
         }
+    }
 
-        file.close();
-    } catch (...) {
-        std::cerr << "Encountered error while exporting commands." << std::endl;
-        throw;
+    if ((!options.archive_add.empty() || options.archive_query) && options.archive.empty()) {
+        std::cerr << "--archive-add and --query need --archive." << std::endl;
+        return false;
+    }
+
+    const auto &sim = options.simulate;
+    if (sim.players < 2 || sim.players > 4 ||
+        sim.self_draw < 0 || sim.gong_direct < 0 || sim.self_draw + sim.gong_direct > 1) {
+        std::cerr << "Invalid simulation settings." << std::endl;
+        return false;
     }
+
+    // Generated logs share the simulation's table and mix of hands
+    auto &gen = options.generate;
+    gen.players = sim.players;
+    gen.self_draw = sim.self_draw;
+    gen.gong_direct = sim.gong_direct;
+    gen.fan_weights = sim.fan_weights;
+    gen.fan_table = sim.fan_table;
+    gen.seed = sim.seed;
+    if (!generate::valid(gen)) {
+        std::cerr << "Invalid generator settings." << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
-void add_history(std::vector<std::string> &commands,
+/**
+ * Append an accepted command to the session journal
+ * @param journal Journal for this session
+ * @param pending Commands entered before the journal could be opened
+ * @param input Raw command to record
+ * @param game Game the command applies to, or nullptr during player setup
+ */
+void add_history(Journal &journal,
+                 std::vector<std::string> &pending,
                  const std::string &input,
-                 const PureHonours &game)
+                 const PureHonours *game)
 {
-    commands.push_back(input);
-    write_history(game.history_filename(), commands);
+    // The filename depends on the players, so open on first use
+    if (!journal.is_open()) {
+        if (!game) {
+            pending.push_back(input);
+            return;
+        }
+
+        const auto filename = game->history_filename();
+        if (!journal.open(filename, true)) {
+            std::cerr << "Failed to open file for writing: " << filename << std::endl;
+            return;
+        }
+
+        // A snapshot of an earlier session would no longer match
+        std::remove(snapshot::filename(filename).c_str());
+
+        for (auto &cmd : pending) {
+            journal.append(cmd);
+        }
+        pending.clear();
+    }
+
+    if (!journal.append(input)) {
+        std::cerr << "Encountered error while exporting commands." << std::endl;
+    }
 }
 
-} // namespace
+// Records an applied command; runs on the core's writer thread
+using Recorder = std::function<void(const Session &session,
+                                    Session::Outcome outcome,
+                                    const std::string &line)>;
 
-int main()
+/**
+ * Feed lines appended to a file into a core until stopped
+ * @param filename File to follow
+ * @param core Core to feed
+ * @param stopping Set to stop following
+ * @param print_mutex Guards standard output
+ * @param record Called for every applied command
+ */
+void follow(const std::string &filename,
+            GameCore &core,
+            const std::atomic<bool> &stopping,
+            std::mutex &print_mutex,
+            const Recorder &record)
 {
-    Shoddy repl;
-    std::vector<std::string> inputs;
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::lock_guard<std::mutex> lock(print_mutex);
+        std::cerr << "Failed to open file for reading: " << filename << std::endl;
+        return;
+    }
 
-    // Get players
-    int players = 0;
-    while (true) {
-        auto input = repl.get_line("How many players? ");
-        if (!input.valid) {
-            return 0;
-        }
-        try {
-            players = std::stoi(input.command);
-        } catch (std::invalid_argument&) {
-            std::cout << "Invalid player count." << std::endl;
+    std::string partial;
+    std::string line;
+    std::uint64_t last = 0;
+    bool reported = true;
+    while (!stopping) {
+        if (std::getline(in, line) && !in.eof()) {
+            line = partial + line;
+            partial.clear();
+            reported = false;
+            last = core.submit(line, [&filename, &print_mutex, record, line](const Session &session,
+                                                                             Session::Outcome outcome,
+                                                                             const std::string &output) {
+                record(session, outcome, line);
+                if (outcome == Session::Outcome::Rejected) {
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    std::cout << filename << ": " << line << ": " << output << std::flush;
+                }
+            });
             continue;
         }
 
-        if (players >= 2 && players <= 4) {
-            inputs.push_back(input.raw_input);
-            break;
-        } else {
-            std::cout << "Invalid player count." << std::endl;
+        // Keep a line still being written until its newline arrives
+        partial += line;
+        line.clear();
+        in.clear();
+
+        // Once a burst has been applied, show where it left the scores
+        if (!reported) {
+            const auto standings = core.standings();
+            if (standings.applied >= last) {
+                reported = true;
+                std::lock_guard<std::mutex> lock(print_mutex);
+                std::cout << filename << ":";
+                for (std::size_t i = 0; i < standings.players.size(); ++i) {
+                    std::cout << " " << standings.players[i] << " " << standings.totals[i];
+                }
+                std::cout << " (" << standings.rounds << " rounds)" << std::endl;
+            }
         }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+}
 
-    int count = 0;
-    std::vector<std::string> player_names;
-    while (count < players) {
-        const std::string prompt = "Initials for player " + std::to_string(count + 1) + ": ";
-        auto input = repl.get_line(prompt);
-        if (!input.valid) {
-            return 0;
+/**
+ * Append to an archive, then query it or summarise it
+ * @param options Archive directory, files to add and query to run
+ * @return True if successful, false otherwise
+ */
+bool run_archive(const Options &options)
+{
+    archive::Archive store;
+    if (!store.open(options.archive)) {
+        std::cerr << "Failed to open archive: " << options.archive << std::endl;
+        return false;
+    }
+
+    if (!options.archive_add.empty()) {
+        std::vector<std::string> files;
+        for (auto &path : options.archive_add) {
+            auto found = archive::find_files(path);
+            files.insert(files.end(), found.begin(), found.end());
         }
+        archive::add_files(store, files, std::cout);
+    }
 
-        // Prevent "self" and "selfg" from being a name (used in command)
-        if (input.command == "self" || input.command == "selfg") {
-            std::cout << "Players cannot be named \"self\"." << std::endl;
+    if (options.archive_query) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = store.query(options.query);
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        archive::print(store, options.query, result, elapsed.count(), std::cout);
+    } else if (options.archive_add.empty()) {
+        std::cout << store.rows() << " rounds from " << store.sessions() << " sessions of "
+                  << store.players() << " players." << std::endl;
+    }
+
+    return true;
+}
+
+/**
+ * Run "<table> <command>" lines through a multi-table engine
+ * @param in Stream of table commands
+ * @param workers Number of worker threads (0 for one per core)
+ */
+void run_tables(std::istream &in, std::size_t workers)
+{
+    std::mutex print_mutex;
+    auto print = [&print_mutex](const std::string &table,
+                                Session::Outcome,
+                                const std::string &output) {
+        if (output.empty()) {
+            return;
+        }
+
+        // Prefix every output line with its table
+        std::lock_guard<std::mutex> lock(print_mutex);
+        std::size_t start = 0;
+        while (start < output.size()) {
+            auto end = output.find('\n', start);
+            if (end == std::string::npos) {
+                end = output.size();
+            }
+            std::cout << table << ": " << output.substr(start, end - start) << '\n';
+            start = end + 1;
+        }
+    };
+
+    Engine engine(workers);
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto split = line.find(' ');
+        if (split == std::string::npos || split == 0) {
             continue;
         }
 
-        player_names.push_back(input.command);
-        inputs.push_back(input.raw_input);
-        ++count;
+        engine.submit(line.substr(0, split), line.substr(split + 1), print);
     }
 
-    // Initialize game
-    PureHonours game(players, std::move(player_names));
+    engine.drain();
 
-    // Get fans
-    std::cout << std::endl;
-    while (true) {
-        auto input = repl.get_line("Add fan/score (Enter to finish, \"d\" for default): ");
-        if (!input.valid) {
+    std::cout << std::endl << "Standings across " << engine.table_count() << " tables:" << std::endl;
+    for (auto &standing : engine.standings()) {
+        std::cout << standing.player << ": " << standing.total
+                  << " (" << standing.tables << " tables, "
+                  << standing.rounds << " rounds)" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: purehonours [--sync always|group|none] "
+                  << "[--sync-records N] [--sync-ms T] "
+                  << "[--snapshot-every N] [--resume <history file>] [--follow <command file>] "
+                  << "[--metrics-file <file>] "
+                  << "[--convert <history file>] "
+                  << "[--batch <file|->] [--report none|scores|full|csv|csv-stdout] "
+                  << "[--tables <file|->] [--league <directory>] [--workers N] "
+                  << "[--archive <directory> [--archive-add <file|directory>] "
+                  << "[--query <winner:X,loser:Y,min-fan:N,max-fan:N,limit:N>]] "
+                  << "[--serve <port|socket path>] [--connect <[host:]port|socket path> [--clients N]] "
+                  << "[--simulate <sessions> [--sim-players N] [--sim-rounds N] "
+                  << "[--self-draw P] [--gong-direct P] [--fan-weights <fan:weight,...>] "
+                  << "[--fan-table <fan:score,...>] [--bust N] [--seed N]] "
+                  << "[--generate <hands> [--sim-players N] [--self-draw P] [--gong-direct P] "
+                  << "[--delete-rate P] [--undo-rate P] [--fan-weights <fan:weight,...>] "
+                  << "[--fan-table <fan:score,...>] [--seed N]]" << std::endl;
+        return 1;
+    }
+
+    // Report hot-path timings and counts however main exits
+    MetricsDump metrics_dump;
+    metrics_dump.filename = options.metrics_file;
+
+    // Score commands sent by table clients
+    if (!options.serve.empty()) {
+        Server server;
+        if (!server.listen(options.serve) || !server.stop_on_signals()) {
+            std::cerr << "Failed to listen on: " << options.serve << std::endl;
+            return 1;
+        }
+
+        return server.run() ? 0 : 1;
+    }
+
+    // Send commands to a server as a stand-in for table clients
+    if (!options.connect.empty()) {
+        return client::run(options.connect, std::cin, std::cout, options.clients);
+    }
+
+    // Score random sessions to compare fan tables
+    if (options.simulate.sessions > 0) {
+        options.simulate.threads = options.workers;
+        simulate::print(options.simulate, simulate::run(options.simulate), std::cout);
+        return 0;
+    }
+
+    // Synthetic session log for load tests
+    if (options.generate_log) {
+        generate::write(options.generate, std::cout);
+        return 0;
+    }
+
+    // Season standings from every history and CSV file below a directory
+    if (!options.league.empty()) {
+        auto files = league::find_files(options.league);
+        league::print(league::aggregate(files, options.workers), std::cout);
+        return 0;
+    }
+
+    // Long-term round archive
+    if (!options.archive.empty()) {
+        return run_archive(options) ? 0 : 1;
+    }
+
+    // Host many tables fed by "<table> <command>" lines
+    if (!options.tables.empty()) {
+        if (options.tables == "-") {
+            run_tables(std::cin, options.workers);
             return 0;
-        } else if (input.command[0] == 'd') {
-            add_history(inputs, input.raw_input, game);
-            game.default_fans();
-            break;
-        } else if (input.arg_count < 1) {
-            std::cout << "Invalid input." << std::endl;
-            continue;
         }
 
-        try {
-            game.add_fan_score(std::stoi(input.command), std::stoi(input.args[0]));
-            add_history(inputs, input.raw_input, game);
-        } catch (std::invalid_argument&) {
-            std::cout << "Invalid input." << std::endl;
-            continue;
+        std::ifstream in(options.tables);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open file for reading: " << options.tables << std::endl;
+            return 1;
         }
+
+        run_tables(in, options.workers);
+        return 0;
     }
 
-    // Game loop
-    const std::string prompt = "\nInput command (? for help): ";
-    while (true) {
-        auto input = repl.get_line(prompt);
-        if (!input.valid || input.command[0] == 'q') {
-            // Quit
-            return 0;
-        } else if (input.command[0] == '?') {
-            // Help
-            std::cout << "Commands:\n"
-                      << "  ?\n"
-                      << "    Display help\n"
-                      << "  q\n"
-                      << "    Quit\n"
-                      << "  a <winner> <fan> self\n"
-                      << "    Add self-touch win by <winner>\n"
-                      << "  a <winner> <fan> selfg <loser>\n"
-                      << "    Add self-touch off gong win by <winner>\n"
-                      << "  a <winner> <fan> <loser>\n"
-                      << "    Add a win by <winner>, fed by <loser>\n"
-                      << "  d\n"
-                      << "    Delete the last-entered score\n"
-                      << "  d <round_number>\n"
-                      << "    Delete the score of a specific round\n"
-                      << "  s\n"
-                      << "    Print short score report\n"
-                      << "  p\n"
-                      << "    Print full score report\n"
-                      << "  c\n"
-                      << "    Export results to CSV file\n";
-        } else if (input.command[0] == 'a' && input.arg_count >= 3) {
-            // Add
-            auto winner = input.args[0];
-            for (auto &c : winner) {
-                c = std::toupper(c);
+    // Run a recorded command stream without prompts or history
+    if (!options.batch.empty()) {
+        std::FILE *in = stdin;
+        if (options.batch != "-") {
+            in = std::fopen(options.batch.c_str(), "rb");
+            if (!in) {
+                std::cerr << "Failed to open file for reading: " << options.batch << std::endl;
+                return 1;
             }
+        }
 
-            // Check winner
-            std::size_t winner_index = game.player_index(winner);
-            if (winner_index == static_cast<std::size_t>(players)) {
-                std::cout << "Invalid winner initials." << std::endl;
-                continue;
-            }
+        Session batch_session(nullptr);
+        batch::run(in, batch_session);
+        if (in != stdin) {
+            std::fclose(in);
+        }
 
-            // If self-draw, just add it
-            int fan = 0;
-            try {
-                fan = std::stoi(input.args[1]);
-            } catch (std::invalid_argument &) {
-                std::cout << "Invalid fan value." << std::endl;
-                continue;
-            }
+        batch::print_report(batch_session, options.report);
+        return 0;
+    }
 
-            if (input.args[2] == "self") {
-                game.add_result(winner_index, fan, true);
-                add_history(inputs, input.raw_input, game);
-            } else {
-                // Check for direct gong
-                auto loser = input.args[2];
-                bool is_gong_self = false;
-                std::size_t loser_index = 0;
-                if (loser == "selfg" && input.arg_count >= 4) {
-                    is_gong_self = true;
-                    loser = input.args[3];
-                } else if (loser == "selfg") {
-                    std::cout << "Invalid loser initials for direct hit gong win." << std::endl;
-                    continue;
-                }
+    // Convert a history file to a binary session file and exit
+    if (!options.convert.empty()) {
+        auto output = options.convert;
+        const std::string extension = ".purehonours";
+        if (output.size() > extension.size() &&
+            output.compare(output.size() - extension.size(), extension.size(), extension) == 0) {
+            output.erase(output.size() - extension.size());
+        }
+        output += ".phs";
 
-                // Not direct gong
-                for (auto &c : loser) {
-                    c = std::toupper(c);
-                }
+        if (!session_file::convert(options.convert, output)) {
+            std::cerr << "Failed to convert: " << options.convert << std::endl;
+            return 1;
+        }
 
-                loser_index = game.player_index(loser);
-                if (loser_index == static_cast<std::size_t>(players)) {
-                    std::cout << "Invalid loser initials." << std::endl;
-                    continue;
-                }
+        std::cout << "Saved to: " << output << std::endl;
+        return 0;
+    }
 
-                // Add score
-                game.add_result(winner_index, fan, is_gong_self, loser_index, is_gong_self);
-                add_history(inputs, input.raw_input, game);
-            }
-        } else if (input.command[0] == 'd') {
-            // Check for index
-            if (input.arg_count > 0) {
-                std::size_t index;
-                try {
-                    index = std::stoul(input.args[0]);
-                } catch (std::invalid_argument&) {
-                    std::cout << "Invalid round number." << std::endl;
-                    continue;
-                }
-                if (game.delete_score(index)) {
-                    add_history(inputs, input.raw_input, game);
-                    std::cout << "Deleted round " << index << "." << std::endl;
-                } else {
-                    std::cout << "Invalid round number." << std::endl;
-                }
-            } else {
-                if (game.delete_score()) {
-                    add_history(inputs, input.raw_input, game);
-                    std::cout << "Deleted last round." << std::endl;
-                } else {
-                    std::cout << "No entries to delete." << std::endl;
-                }
+    Journal journal(options.durability,
+                    options.group_records,
+                    std::chrono::milliseconds(options.group_ms));
+    Session session(&std::cout);
+    std::vector<std::string> pending;
+
+    // Rebuild from an earlier history and keep appending to it
+    std::string history_filename;
+    if (!options.resume.empty()) {
+        history_filename = options.resume;
+        if (!snapshot::resume(history_filename, session) ||
+            !journal.open(history_filename, false)) {
+            std::cerr << "Failed to resume from: " << history_filename << std::endl;
+            return 1;
+        }
+
+        if (session.game()) {
+            session.game()->print_scores();
+        }
+    }
+
+    // Every command source feeds one core; only its writer thread touches
+    // the session, journal and snapshots
+    std::size_t since_snapshot = 0;
+    Recorder record = [&](const Session &applied, Session::Outcome outcome, const std::string &line) {
+        if (outcome != Session::Outcome::Accepted) {
+            return;
+        }
+
+        const PureHonours *game = applied.game();
+        add_history(journal, pending, line, game);
+        if (game && history_filename.empty()) {
+            history_filename = game->history_filename();
+        }
+
+        // Periodically snapshot so resuming only replays the tail
+        if (game && options.snapshot_every > 0 &&
+            applied.phase() == Session::Phase::Playing &&
+            ++since_snapshot >= options.snapshot_every) {
+            since_snapshot = 0;
+            if (!journal.sync() ||
+                !snapshot::write(snapshot::filename(history_filename), *game, journal.offset())) {
+                std::cerr << "Failed to write snapshot for: " << history_filename << std::endl;
             }
-        } else if (input.command[0] == 's') {
-            game.print_scores();
-        } else if (input.command[0] == 'p') {
-            game.print_report();
-        } else if (input.command[0] == 'x') {
-            game.print_csv();
-        } else {
-            // Invalid
-            std::cout << "Invalid command. Type ? for help." << std::endl;
         }
+    };
+
+    // Exports are written from copies in the background so entry never waits
+    Exporter exporter(options.workers);
+    session.set_exporter(&exporter);
+
+    std::string prompt = session.prompt();
+
+    // Groups of journal records left waiting by a pause are synced on time
+    GameCore core(std::move(session), [&journal]() { return journal.sync_due(); });
+    std::mutex print_mutex;
+
+    // Commands appended to a followed file are applied alongside the REPL
+    std::atomic<bool> stopping(false);
+    std::thread follower;
+    if (!options.follow.empty()) {
+        follower = std::thread([&]() {
+            follow(options.follow, core, stopping, print_mutex, record);
+        });
+    }
+
+    Shoddy repl;
+    bool quit = false;
+    auto report_exports = [&]() {
+        const auto messages = exporter.finished();
+        std::lock_guard<std::mutex> lock(print_mutex);
+        for (auto &message : messages) {
+            std::cout << message << std::endl;
+        }
+    };
+
+    while (!quit) {
+        report_exports();
+        auto input = repl.get_line(prompt);
+        if (!input.valid) {
+            break;
+        }
+
+        // Wait for our own command so the next prompt follows its output
+        std::promise<void> applied;
+        const auto line = input.raw_input;
+        core.submit(line, [&, line](const Session &current,
+                                    Session::Outcome outcome,
+                                    const std::string &output) {
+            {
+                std::lock_guard<std::mutex> lock(print_mutex);
+                std::cout << output << std::flush;
+            }
+
+            record(current, outcome, line);
+            prompt = current.prompt();
+            quit = outcome == Session::Outcome::Quit;
+            applied.set_value();
+        });
+        applied.get_future().wait();
+    }
+
+    stopping = true;
+    if (follower.joinable()) {
+        follower.join();
     }
 
+    core.drain();
+    exporter.wait();
+    report_exports();
+
     return 0;
 }
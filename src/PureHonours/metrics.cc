@@ -0,0 +1,268 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+namespace
+{
+
+// Power-of-two nanosecond buckets: bucket i holds [2^(i-1), 2^i)
+const std::size_t BUCKETS = 64;
+
+const char *const TIMER_NAMES[] = {
+    "command", "add_result", "delete_score", "undo_redo", "report",
+    "csv", "export", "journal_append", "journal_sync", "snapshot",
+};
+
+const char *const COUNTER_NAMES[] = {
+    "bytes_written", "journal_appends", "journal_rewrites", "snapshot_writes",
+    "allocations", "allocated_bytes",
+};
+
+static_assert(sizeof(TIMER_NAMES) / sizeof(TIMER_NAMES[0]) ==
+              static_cast<std::size_t>(metrics::Timer::Count), "Name every timer");
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) ==
+              static_cast<std::size_t>(metrics::Counter::Count), "Name every counter");
+
+struct Histogram {
+    std::atomic<std::uint64_t> calls;
+    std::atomic<std::uint64_t> count; // Calls timed
+    std::atomic<std::uint64_t> total;
+    std::atomic<std::uint64_t> max;
+    std::atomic<std::uint64_t> buckets[BUCKETS];
+};
+
+// Zero-initialized before any code runs, so allocations during static
+// initialization can already be counted
+Histogram histograms[static_cast<std::size_t>(metrics::Timer::Count)];
+std::atomic<std::uint64_t> counters[static_cast<std::size_t>(metrics::Counter::Count)];
+
+/**
+ * Add to a counter shared by every thread
+ * @param counter Counter to add to
+ * @param amount Amount to add
+ */
+void bump(std::atomic<std::uint64_t> &counter, std::uint64_t amount)
+{
+    counter.fetch_add(amount, std::memory_order_relaxed);
+}
+
+/**
+ * Raise a maximum shared by every thread
+ * @param max Maximum to raise
+ * @param value Value to raise it to, if larger
+ */
+void raise(std::atomic<std::uint64_t> &max, std::uint64_t value)
+{
+    auto current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Find the bucket for a duration
+ * @param nanoseconds Duration
+ * @return Bucket index
+ */
+std::size_t bucket(std::uint64_t nanoseconds)
+{
+    const auto bits = nanoseconds == 0 ? 0 : 64 - static_cast<std::size_t>(__builtin_clzll(nanoseconds));
+    return std::min(bits, BUCKETS - 1);
+}
+
+#ifdef PUREHONOURS_METRICS
+
+/**
+ * Estimate a percentile from a histogram
+ * @param histogram Histogram to read
+ * @param count Number of samples in the histogram
+ * @param percent Percentile to find
+ * @return Upper bound of the bucket holding the percentile, in nanoseconds
+ */
+std::uint64_t percentile(const Histogram &histogram, std::uint64_t count, double percent)
+{
+    const auto rank = static_cast<std::uint64_t>(count * percent / 100);
+    const auto max = histogram.max.load(std::memory_order_relaxed);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += histogram.buckets[i].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            return i == 0 ? 0 : std::min(std::uint64_t(1) << i, max);
+        }
+    }
+
+    return max;
+}
+
+#endif
+
+} // namespace
+
+namespace metrics
+{
+
+/**
+ * Count a call to a timed operation
+ * @param timer Timer for the operation
+ * @return True if this call should be timed, false otherwise
+ */
+bool start(Timer timer)
+{
+    bump(histograms[static_cast<std::size_t>(timer)].calls, 1);
+
+    switch (timer) {
+    case Timer::Command:
+    case Timer::AddResult:
+    case Timer::DeleteScore:
+    case Timer::Undo:
+    case Timer::JournalAppend: {
+        static thread_local unsigned calls[static_cast<std::size_t>(Timer::Count)];
+        return calls[static_cast<std::size_t>(timer)]++ % SAMPLE_EVERY == 0;
+    }
+    default:
+        return true;
+    }
+}
+
+/**
+ * Add a sample to a timer's histogram
+ * @param timer Timer to record
+ * @param nanoseconds Time taken
+ */
+void record(Timer timer, std::uint64_t nanoseconds)
+{
+    auto &histogram = histograms[static_cast<std::size_t>(timer)];
+    bump(histogram.count, 1);
+    bump(histogram.total, nanoseconds);
+    bump(histogram.buckets[bucket(nanoseconds)], 1);
+    raise(histogram.max, nanoseconds);
+}
+
+/**
+ * Increase a counter
+ * @param counter Counter to increase
+ * @param amount Amount to add
+ */
+void add(Counter counter, std::uint64_t amount)
+{
+    bump(counters[static_cast<std::size_t>(counter)], amount);
+}
+
+/**
+ * Print every timer and counter
+ * @param out Stream to print to
+ */
+void print(std::ostream &out)
+{
+#ifndef PUREHONOURS_METRICS
+    out << "Metrics are not enabled in this build (PUREHONOURS_METRICS)." << std::endl;
+#else
+    out << std::left << std::setw(16) << "Timer" << std::right
+        << std::setw(10) << "Calls"
+        << std::setw(10) << "Timed"
+        << std::setw(12) << "Mean ns"
+        << std::setw(12) << "p50 ns"
+        << std::setw(12) << "p99 ns"
+        << std::setw(14) << "Max ns" << '\n';
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Timer::Count); ++i) {
+        const auto &histogram = histograms[i];
+        const auto count = histogram.count.load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+
+        out << std::left << std::setw(16) << TIMER_NAMES[i] << std::right
+            << std::setw(10) << histogram.calls.load(std::memory_order_relaxed)
+            << std::setw(10) << count
+            << std::setw(12) << histogram.total.load(std::memory_order_relaxed) / count
+            << std::setw(12) << percentile(histogram, count, 50)
+            << std::setw(12) << percentile(histogram, count, 99)
+            << std::setw(14) << histogram.max.load(std::memory_order_relaxed) << '\n';
+    }
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Counter::Count); ++i) {
+        out << std::left << std::setw(16) << COUNTER_NAMES[i] << std::right
+            << std::setw(10) << counters[i].load(std::memory_order_relaxed) << '\n';
+    }
+    out << std::flush;
+#endif
+}
+
+/**
+ * Write the metrics report to a file
+ * @param filename Path to write to
+ * @return True if successful, false otherwise
+ */
+bool dump(const std::string &filename)
+{
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    print(file);
+    file.close();
+    return !file.fail();
+}
+
+} // namespace metrics
+
+#ifdef PUREHONOURS_METRICS
+
+// Count every heap allocation in the process
+
+void *operator new(std::size_t size)
+{
+    metrics::add(metrics::Counter::Allocations);
+    metrics::add(metrics::Counter::AllocatedBytes, size);
+    if (auto p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    metrics::add(metrics::Counter::Allocations);
+    metrics::add(metrics::Counter::AllocatedBytes, size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Hot-path instrumentation
+//
+// Built in only with PUREHONOURS_METRICS defined; otherwise the macros
+// below expand to nothing and the report says metrics are disabled. Timers
+// on the per-command path count every call but only time one in
+// SAMPLE_EVERY, since reading the clock costs about as much as the work.
+namespace metrics
+{
+
+// Timed operations, each with its own latency histogram
+enum class Timer {
+    Command,
+    AddResult,
+    DeleteScore,
+    Undo,
+    Report,
+    Csv,
+    Export,
+    JournalAppend,
+    JournalSync,
+    Snapshot,
+    Count,
+};
+
+// Calls per timed call for the per-command timers
+const unsigned SAMPLE_EVERY = 8;
+
+enum class Counter {
+    BytesWritten,
+    JournalAppends,
+    JournalRewrites,
+    SnapshotWrites,
+    Allocations,
+    AllocatedBytes,
+    Count,
+};
+
+bool start(Timer timer);
+void record(Timer timer, std::uint64_t nanoseconds);
+void add(Counter counter, std::uint64_t amount = 1);
+void print(std::ostream &out);
+bool dump(const std::string &filename);
+
+/**
+ * Counts a call and, if it is sampled, records the time until the end of
+ * the enclosing scope
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer timer)
+    : timer_(timer),
+      timing_(start(timer))
+    {
+        if (timing_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (!timing_) {
+            return;
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        record(timer_, static_cast<std::uint64_t>(
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Timer timer_;
+    bool timing_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace metrics
+
+#ifdef PUREHONOURS_METRICS
+#define METRICS_TIME(timer) metrics::ScopedTimer metrics_timer_(metrics::Timer::timer)
+#define METRICS_ADD(counter, amount) metrics::add(metrics::Counter::counter, (amount))
+#else
+#define METRICS_TIME(timer) static_cast<void>(0)
+#define METRICS_ADD(counter, amount) static_cast<void>(0)
+#endif
+
+#endif // __METRICS_H
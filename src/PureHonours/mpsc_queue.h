@@ -0,0 +1,82 @@
+#ifndef __MPSC_QUEUE_H
+#define __MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bytes per cache line, to keep producer and consumer ends apart
+const std::size_t CACHE_LINE = 64;
+
+/**
+ * Unbounded lock-free queue for many producers and one consumer
+ *
+ * Intrusive-list design after Dmitry Vyukov: a push is one exchange and
+ * one store, and never waits for other producers or the consumer. A pop
+ * can miss an element whose producer is between those two steps, so the
+ * consumer must treat an empty pop as "nothing yet", not "nothing ever".
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+    : head_(new Node()),
+      tail_(head_.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /**
+     * Add an element; safe from any thread
+     * @param value Element to add
+     */
+    void push(T &&value)
+    {
+        auto node = new Node(std::move(value));
+        auto prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Take the oldest element; consumer thread only
+     * @param value Set to the element taken
+     * @return True if an element was taken, false otherwise
+     */
+    bool pop(T &value)
+    {
+        auto next = tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+
+        // The taken node becomes the new stub
+        value = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next;
+        T value;
+
+        Node() : next(nullptr), value() {}
+        explicit Node(T &&v) : next(nullptr), value(std::move(v)) {}
+    };
+
+    alignas(CACHE_LINE) std::atomic<Node *> head_;
+    alignas(CACHE_LINE) Node *tail_;
+};
+
+#endif // __MPSC_QUEUE_H
@@ -0,0 +1,233 @@
+#include "output_buffer.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <unistd.h>
+
+/**
+ * Constructor for file descriptor sink
+ * @param fd Open descriptor; not closed by the sink
+ */
+FdSink::FdSink(int fd)
+: fd_(fd)
+{
+}
+
+/**
+ * Write all bytes to the descriptor
+ * @param data Bytes to write
+ * @param length Number of bytes
+ * @return True if successful, false otherwise
+ */
+bool FdSink::write(const char *data, std::size_t length)
+{
+    while (length > 0) {
+        auto written = ::write(fd_, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return false;
+        }
+
+        data += written;
+        length -= static_cast<std::size_t>(written);
+    }
+
+    return true;
+}
+
+/**
+ * Constructor for stream sink
+ * @param out Stream to write to
+ */
+StreamSink::StreamSink(std::ostream &out)
+: out_(out)
+{
+}
+
+bool StreamSink::write(const char *data, std::size_t length)
+{
+    out_.write(data, static_cast<std::streamsize>(length));
+    return static_cast<bool>(out_);
+}
+
+/**
+ * Constructor for string sink
+ * @param out String to append to
+ */
+StringSink::StringSink(std::string &out)
+: out_(out)
+{
+}
+
+bool StringSink::write(const char *data, std::size_t length)
+{
+    out_.append(data, length);
+    return true;
+}
+
+/**
+ * Constructor for output buffer
+ * @param sink Where full chunks are written
+ * @param capacity Chunk size in bytes
+ */
+OutputBuffer::OutputBuffer(Sink &sink, std::size_t capacity)
+: sink_(sink),
+  buffer_(capacity == 0 ? 1 : capacity),
+  used_(0),
+  bytes_written_(0),
+  good_(true)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+}
+
+/**
+ * Append a character
+ * @param c Character to append
+ */
+void OutputBuffer::put(char c)
+{
+    if (used_ == buffer_.size()) {
+        flush();
+    }
+
+    buffer_[used_++] = c;
+}
+
+/**
+ * Append bytes
+ * @param data Bytes to append
+ * @param length Number of bytes
+ */
+void OutputBuffer::put(const char *data, std::size_t length)
+{
+    if (used_ + length > buffer_.size()) {
+        flush();
+
+        // Too big to be worth buffering
+        if (length > buffer_.size()) {
+            good_ = sink_.write(data, length) && good_;
+            bytes_written_ += length;
+            return;
+        }
+    }
+
+    std::memcpy(buffer_.data() + used_, data, length);
+    used_ += length;
+}
+
+void OutputBuffer::put(const std::string &text)
+{
+    put(text.data(), text.size());
+}
+
+/**
+ * Format an integer in decimal without allocating
+ * @param value Value to format
+ * @param text Receives at least MAX_INT_LENGTH characters; not terminated
+ * @return Number of characters written
+ */
+std::size_t OutputBuffer::format_int(long long value, char *text)
+{
+    char digits[MAX_INT_LENGTH];
+    char *end = digits + sizeof(digits);
+    char *pos = end;
+
+    // Work in negative numbers so the minimum value does not overflow
+    const bool negative = value < 0;
+    if (!negative) {
+        value = -value;
+    }
+
+    do {
+        *--pos = static_cast<char>('0' - value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    if (negative) {
+        *--pos = '-';
+    }
+
+    const auto length = static_cast<std::size_t>(end - pos);
+    std::memcpy(text, pos, length);
+    return length;
+}
+
+/**
+ * Append an integer in decimal without allocating
+ * @param value Value to append
+ */
+void OutputBuffer::put_int(long long value)
+{
+    char text[MAX_INT_LENGTH];
+    put(text, format_int(value, text));
+}
+
+/**
+ * Append a character several times
+ * @param c Character to append
+ * @param count Number of times
+ */
+void OutputBuffer::put_repeat(char c, std::size_t count)
+{
+    while (count > 0) {
+        if (used_ == buffer_.size()) {
+            flush();
+        }
+
+        auto chunk = std::min(count, buffer_.size() - used_);
+        std::memset(buffer_.data() + used_, c, chunk);
+        used_ += chunk;
+        count -= chunk;
+    }
+}
+
+/**
+ * Write buffered bytes to the sink
+ * @return True if everything so far was written, false otherwise
+ */
+bool OutputBuffer::flush()
+{
+    if (used_ > 0) {
+        good_ = sink_.write(buffer_.data(), used_) && good_;
+        bytes_written_ += used_;
+        METRICS_ADD(BytesWritten, used_);
+        used_ = 0;
+    }
+
+    return good_;
+}
+
+/**
+ * Check for write errors
+ * @return True if every write so far succeeded, false otherwise
+ */
+bool OutputBuffer::good() const
+{
+    return good_;
+}
+
+/**
+ * Get bytes handed to the sink
+ * @return Number of bytes flushed so far
+ */
+std::size_t OutputBuffer::bytes_written() const
+{
+    return bytes_written_;
+}
+
+/**
+ * Get bytes put so far, whether flushed or still buffered
+ * @return Number of bytes put
+ */
+std::size_t OutputBuffer::position() const
+{
+    return bytes_written_ + used_;
+}
@@ -0,0 +1,89 @@
+#ifndef __OUTPUT_BUFFER_H
+#define __OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * Destination for buffered output
+ */
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual bool write(const char *data, std::size_t length) = 0;
+};
+
+/**
+ * Sink writing to a file descriptor (file, stdout, pipe or socket)
+ */
+class FdSink : public Sink {
+public:
+    explicit FdSink(int fd);
+    bool write(const char *data, std::size_t length) override;
+
+private:
+    int fd_;
+};
+
+/**
+ * Sink writing to a standard stream
+ */
+class StreamSink : public Sink {
+public:
+    explicit StreamSink(std::ostream &out);
+    bool write(const char *data, std::size_t length) override;
+
+private:
+    std::ostream &out_;
+};
+
+/**
+ * Sink appending to a string
+ */
+class StringSink : public Sink {
+public:
+    explicit StringSink(std::string &out);
+    bool write(const char *data, std::size_t length) override;
+
+private:
+    std::string &out_;
+};
+
+/**
+ * Reusable formatting buffer that writes to its sink in large chunks
+ */
+class OutputBuffer {
+public:
+    // Longest text format_int can produce
+    static const std::size_t MAX_INT_LENGTH = 20;
+
+    static std::size_t format_int(long long value, char *text);
+
+    explicit OutputBuffer(Sink &sink, std::size_t capacity = 64 * 1024);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void put(char c);
+    void put(const char *data, std::size_t length);
+    void put(const std::string &text);
+    void put_int(long long value);
+    void put_repeat(char c, std::size_t count);
+    bool flush();
+
+    bool good() const;
+    std::size_t bytes_written() const;
+    std::size_t position() const;
+
+private:
+    Sink &sink_;
+    std::vector<char> buffer_;
+    std::size_t used_;
+    std::size_t bytes_written_;
+    bool good_;
+};
+
+#endif // __OUTPUT_BUFFER_H
@@ -0,0 +1,91 @@
+#include "player_ids.h"
+
+#include <cstring>
+
+namespace
+{
+
+/**
+ * Upper-case an ASCII letter without locale lookups
+ * @param c Character to convert
+ * @return Upper-case c, or c unchanged
+ */
+char upper(char c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+/**
+ * FNV-1a hash of the upper-cased characters
+ * @param data Characters to hash
+ * @param size Number of characters
+ * @return Hash value
+ */
+std::uint32_t hash_upper(const char *data, std::size_t size)
+{
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(upper(data[i]));
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+} // namespace
+
+/**
+ * Intern the players' initials
+ *
+ * Entered initials are upper-cased before matching, as they always have
+ * been, so a name set up with lower-case letters can never be found.
+ * @param names Initials of players, in seat order
+ */
+void PlayerIds::assign(const std::vector<std::string> &names)
+{
+    names_ = names;
+    std::memset(slots_, 0, sizeof(slots_));
+
+    for (std::size_t i = 0; i < names_.size() && i < SLOTS - 1; ++i) {
+        const auto &name = names_[i];
+
+        // A repeated name keeps its first seat; upper-case names hash as typed
+        if (find(tokens::Token(name.data(), name.size())) != names_.size()) {
+            continue;
+        }
+
+        std::size_t slot = hash_upper(name.data(), name.size()) & (SLOTS - 1);
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & (SLOTS - 1);
+        }
+        slots_[slot] = static_cast<std::uint8_t>(i + 1);
+    }
+}
+
+/**
+ * Find a player from entered initials
+ * @param token Initials in any case
+ * @return Seat of the player; the number of players if not found
+ */
+std::size_t PlayerIds::find(const tokens::Token &token) const
+{
+    std::size_t slot = hash_upper(token.data, token.size) & (SLOTS - 1);
+    while (slots_[slot] != 0) {
+        const std::size_t seat = slots_[slot] - 1u;
+        const auto &name = names_[seat];
+        if (name.size() == token.size) {
+            std::size_t i = 0;
+            while (i < token.size && name[i] == upper(token.data[i])) {
+                ++i;
+            }
+
+            if (i == token.size) {
+                return seat;
+            }
+        }
+
+        slot = (slot + 1) & (SLOTS - 1);
+    }
+
+    return names_.size();
+}
@@ -0,0 +1,31 @@
+#ifndef __PLAYER_IDS_H
+#define __PLAYER_IDS_H
+
+#include "tokens.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Player initials interned into seat numbers
+ *
+ * Built once when the players are set up. Lookups upper-case the token on
+ * the fly and probe a small open-addressed table, so finding a player takes
+ * constant time and never copies the token.
+ */
+class PlayerIds {
+public:
+    void assign(const std::vector<std::string> &names);
+    std::size_t find(const tokens::Token &token) const;
+
+private:
+    // Power of two comfortably above MAX_PLAYERS
+    static const std::size_t SLOTS = 16;
+
+    std::vector<std::string> names_;
+    std::uint8_t slots_[SLOTS] = {}; // Seat + 1, or 0 if empty
+};
+
+#endif // __PLAYER_IDS_H
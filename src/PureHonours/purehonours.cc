@@ -1,12 +1,19 @@
 #include "purehonours.h"
+#include "metrics.h"
+#include "output_buffer.h"
+#include "session_file.h"
 
 #include <algorithm>
+#include <array>
+#include <cassert>
 #include <chrono>
 #include <ctime>
-#include <fstream>
+#include <fcntl.h>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <unistd.h>
 
 // Helper functions for report printing
 namespace report
@@ -17,45 +24,283 @@ static const std::size_t ROUND_WIDTH = 8;
 // Width of player score column
 static const std::size_t COLUMN_WIDTH = 10;
 
+// Largest buffer allocated for one report
+static const std::size_t MAX_BUFFER = 1 << 20;
+
 /**
- * Pad a string to given length
- * @param input Input string to pad
- * @param length Length to pad to
- * @return Original input if cannot be padded, else a padded string
+ * Write text centred in a column
+ * @param out Buffer to write to
+ * @param text Text to write
+ * @param length Length of text
+ * @param width Width of column; text is written as-is if it does not fit
  */
-std::string centre_pad(const std::string &input, std::size_t length)
+void put_centred(OutputBuffer &out, const char *text, std::size_t length, std::size_t width)
 {
-    // Make sure we can actually pad it
-    if (length <= input.size()) {
-        return input;
+    if (width <= length) {
+        out.put(text, length);
+        return;
     }
 
-    std::size_t space = length - input.size();
+    std::size_t space = width - length;
     std::size_t left_pad = space / 2;
 
-    return std::string(left_pad, ' ') + input + std::string(space - left_pad, ' ');
+    out.put_repeat(' ', left_pad);
+    out.put(text, length);
+    out.put_repeat(' ', space - left_pad);
+}
+
+void put_centred(OutputBuffer &out, const std::string &text, std::size_t width = COLUMN_WIDTH)
+{
+    put_centred(out, text.data(), text.size(), width);
+}
+
+void put_centred(OutputBuffer &out, long long value, std::size_t width = COLUMN_WIDTH)
+{
+    char text[OutputBuffer::MAX_INT_LENGTH];
+    put_centred(out, text, OutputBuffer::format_int(value, text), width);
 }
 
-std::string centre_pad(const std::string &input)
+/**
+ * Write a horizontal rule
+ * @param out Buffer to write to
+ * @param columns Number of player columns
+ */
+void put_rule(OutputBuffer &out, int columns)
 {
-    return centre_pad(input, COLUMN_WIDTH);
+    out.put('+');
+    out.put_repeat('-', ROUND_WIDTH);
+    for (auto i = 0; i < columns; ++i) {
+        out.put('+');
+        out.put_repeat('-', COLUMN_WIDTH);
+    }
+    out.put("+\n", 2);
 }
 
 } // namespace report
 
+// Dense fan/score tables
+namespace fans
+{
+
+// Default scores indexed by fan (3 fan minimum, 13 fan maximum)
+constexpr int DEFAULT_SCORES[] = {0, 0, 0, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+constexpr std::size_t DEFAULT_SIZE = sizeof(DEFAULT_SCORES) / sizeof(DEFAULT_SCORES[0]);
+
+/**
+ * Score paid by each loser on a self-draw
+ * @param score Score for the fan
+ * @param player_count Number of players
+ * @return Self-win score (150%) divided by number of remaining players
+ */
+constexpr int self_draw_score(int score, int player_count)
+{
+    return score * 3 / 2 / (player_count - 1);
+}
+
+// Self-draw variant of the default scores for a player count
+template <int PlayerCount>
+struct DefaultSelfDraw {
+    static constexpr int SCORES[DEFAULT_SIZE] = {
+        self_draw_score(DEFAULT_SCORES[0], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[1], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[2], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[3], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[4], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[5], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[6], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[7], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[8], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[9], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[10], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[11], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[12], PlayerCount),
+        self_draw_score(DEFAULT_SCORES[13], PlayerCount),
+    };
+};
+
+template <int PlayerCount>
+constexpr int DefaultSelfDraw<PlayerCount>::SCORES[DEFAULT_SIZE];
+
+static_assert(DEFAULT_SIZE == 14, "DefaultSelfDraw lists every default fan");
+static_assert(DefaultSelfDraw<4>::SCORES[3] == 16, "3 fan self-draw pays 16 each at four players");
+
+} // namespace fans
+
+// Scoring kernels specialised on player count
+namespace scoring
+{
+
+/**
+ * Fan score lookup hoisted out of a scoring loop
+ */
+class FanLookup {
+public:
+    /**
+     * Constructor for lookup
+     * @param fan_table Score by fan
+     * @param self_draw_table Self-draw score paid by each loser, by fan
+     */
+    FanLookup(const std::vector<int> &fan_table, const std::vector<int> &self_draw_table)
+    {
+        static const int NONE[] = {0};
+        const bool empty = fan_table.empty();
+        tables_[0] = empty ? NONE : fan_table.data();
+        tables_[1] = empty ? NONE : self_draw_table.data();
+        last_ = empty ? 0 : fan_table.size() - 1;
+    }
+
+    /**
+     * Find the score for a round without branching on its kind
+     * @param round Round to look up
+     * @return Score for the round's fan, per loser if a self-draw
+     */
+    int operator()(const Round &round) const
+    {
+        return tables_[round.flags & Round::SELF_DRAW][std::min<std::size_t>(round.fan, last_)];
+    }
+
+private:
+    const int *tables_[2];
+    std::size_t last_;
+};
+
+/**
+ * What the winner, the loser and everyone else get in a round
+ */
+struct Shares {
+    int win;
+    int lose;
+    int rest;
+};
+
+/**
+ * Work out a round's shares at a table of N players without branching
+ * @param round Round to score
+ * @param score Score for the round's fan, per loser if a self-draw
+ * @return Score change for the winner, the loser and everyone else
+ */
+template <std::size_t N>
+inline Shares shares(const Round &round, int score)
+{
+    const int others = static_cast<int>(N) - 1;
+    const int self_draw = round.flags & Round::SELF_DRAW ? 1 : 0;
+    const int gong_direct = round.flags & Round::GONG_DIRECT ? 1 : 0;
+
+    // Everyone else pays on a plain self-draw; otherwise only the loser pays,
+    // for the whole table when they fed a direct gong. On a plain self-draw
+    // the loser's share matches everyone else's.
+    Shares result;
+    result.win = score * (1 + self_draw * (others - 1));
+    result.lose = -score * (1 + gong_direct * (others - 1));
+    result.rest = -score * (self_draw & (gong_direct ^ 1));
+    return result;
+}
+
+/**
+ * Work out score changes for a round at a table of N players
+ * @param round Round to score
+ * @param score Score for the round's fan, per loser if a self-draw
+ * @return One score change per player
+ */
+template <std::size_t N>
+inline std::array<int, N> score_row(const Round &round, int score)
+{
+    const auto share = shares<N>(round, score);
+
+    // The winner is written last so a round fed by the winner pays nothing
+    std::array<int, N> row;
+    row.fill(share.rest);
+    if (round.losing_player < N) {
+        row[round.losing_player] = share.lose;
+    }
+    if (round.winning_player < N) {
+        row[round.winning_player] = share.win;
+    }
+
+    return row;
+}
+
+} // namespace scoring
+
+// Undo history housekeeping
+namespace history
+{
+
+// Unreachable tombstones tolerated before compacting
+static const std::size_t COMPACT_MIN = 1024;
+// Compact once unreachable tombstones are at least 1/COMPACT_RATIO of the rounds
+static const std::size_t COMPACT_RATIO = 4;
+
+} // namespace history
+
 /**
  * Constructor for game
  * @param player_count Number of players
  * @param player_names Initials of players
  */
 PureHonours::PureHonours(int player_count, std::vector<std::string> &&player_names)
-: player_names_(player_names)
+: out_(&std::cout),
+  player_names_(player_names),
+  garbage_(0),
+  unchanged_(0),
+  stats_(static_cast<int>(player_names_.size())),
+  tree_rounds_(0)
 {
-    if (player_count < 0 || player_count > 4) {
+    if (player_count < 2 || player_count > 4) {
         player_count = 4;
     }
 
     player_count_ = player_count;
+    totals_.assign(player_count_, 0);
+    switch (player_count_) {
+    case 2:
+        use_kernels<2>();
+        break;
+    case 3:
+        use_kernels<3>();
+        break;
+    default:
+        use_kernels<4>();
+        break;
+    }
+}
+
+/**
+ * Copy the game, quietly, to be written out elsewhere
+ * @param with_edits Whether to copy the undo and redo history too
+ * @return Copy that writes no output
+ */
+std::unique_ptr<PureHonours> PureHonours::copy(bool with_edits) const
+{
+    std::unique_ptr<PureHonours> game(
+        new PureHonours(player_count_, std::vector<std::string>(player_names_)));
+    game->out_ = nullptr;
+    game->fan_to_score_ = fan_to_score_;
+    game->fan_table_ = fan_table_;
+    game->self_draw_table_ = self_draw_table_;
+    game->rounds_ = rounds_;
+    game->live_ = live_;
+    game->garbage_ = garbage_;
+    game->unchanged_ = unchanged_;
+    game->totals_ = totals_;
+    game->stats_ = stats_;
+    if (with_edits) {
+        game->undo_ = undo_;
+        game->redo_ = redo_;
+    }
+
+    return game;
+}
+
+/**
+ * Point the scoring kernels at one player count
+ */
+template <std::size_t N>
+void PureHonours::use_kernels()
+{
+    round_scores_ = &PureHonours::round_scores_for<N>;
+    apply_scores_ = &PureHonours::apply_scores_for<N>;
+    tally_ = &PureHonours::tally_for<N>;
 }
 
 /**
@@ -64,39 +309,86 @@ PureHonours::PureHonours(int player_count, std::vector<std::string> &&player_nam
  * @param score Score for the fan
  */
 void PureHonours::add_fan_score(int fan, int score)
+{
+    if (fan < 0 || fan > MAX_FAN) {
+        if (out_) {
+            *out_ << "Invalid fan value." << std::endl;
+        }
+        return;
+    }
+
+    set_fan_score(fan, score);
+    rebuild_fan_tables();
+}
+
+/**
+ * Set a fan/score pair without rebuilding the lookup tables
+ * @param fan Number of fan
+ * @param score Score for the fan
+ */
+void PureHonours::set_fan_score(int fan, int score)
 {
     // If the fan already exists, replace it, else add it
     if (fan_to_score_.find(fan) == fan_to_score_.end()) {
         fan_to_score_.emplace(fan, score);
-        std::cout << "Added ";
+        if (out_) {
+            *out_ << "Added ";
+        }
     } else {
         fan_to_score_[fan] = score;
-        std::cout << "Set ";
+        if (out_) {
+            *out_ << "Set ";
+        }
+    }
+
+    if (out_) {
+        *out_ << fan << " fan = " << score << "." << std::endl;
+    }
+}
+
+/**
+ * Rebuild the dense lookup tables from the fan/score pairs
+ */
+void PureHonours::rebuild_fan_tables()
+{
+    fan_table_.clear();
+    self_draw_table_.clear();
+    if (fan_to_score_.empty()) {
+        return;
     }
 
-    std::cout << fan << " fan = " << score << "." << std::endl;
+    // Fans past the largest entry score the same as it
+    const int size = std::min(std::max(fan_to_score_.rbegin()->first, 0), MAX_FAN) + 1;
+    fan_table_.reserve(size);
+    self_draw_table_.reserve(size);
+
+    auto it = fan_to_score_.begin();
+    int score = 0;
+    for (int fan = 0; fan < size; ++fan) {
+        while (it != fan_to_score_.end() && it->first <= fan) {
+            score = it->second;
+            ++it;
+        }
+
+        fan_table_.push_back(score);
+        self_draw_table_.push_back(fans::self_draw_score(score, player_count_));
+    }
 }
 
 /**
  * Find a fan score
  * @param fan Number of fan
+ * @param self_draw Whether to give the self-draw score paid by each loser
  * @return Score for that many fan
  */
 int PureHonours::fan_score(int fan, bool self_draw) const
 {
-    int result = 0;
-    for (auto &pair : fan_to_score_) {
-        if (pair.first <= fan) {
-            result = pair.second;
-        }
-    }
-
-    // Divide self-win score (150%) by number of remaining players
-    if (self_draw) {
-        result = result * 3 / 2 / (player_count_ - 1);
+    if (fan < 0 || fan_table_.empty()) {
+        return 0;
     }
 
-    return result;
+    const auto &table = self_draw ? self_draw_table_ : fan_table_;
+    return table[std::min(static_cast<std::size_t>(fan), table.size() - 1)];
 }
 
 /**
@@ -112,52 +404,130 @@ void PureHonours::add_result(std::size_t winning_player,
                              std::size_t losing_player,
                              bool gong_direct)
 {
+    METRICS_TIME(AddResult);
+
+    // Fan is stored in a byte, so a larger fan cannot be recorded as entered
+    if (fan > MAX_FAN) {
+        if (out_) {
+            *out_ << "Invalid fan value." << std::endl;
+        }
+        return;
+    }
+
     // Check for min fan
     auto score = fan_score(fan, self_draw);
     if (score == 0) {
-        std::cout << "No gai woo son." << std::endl;
+        if (out_) {
+            *out_ << "No gai woo son." << std::endl;
+        }
+        return;
+    } else if (fan >= fan_to_score_.rbegin()->first && out_) {
+        *out_ << "Sick max yo." << std::endl;
+    }
+
+    // An edit has to be able to name the new round
+    if (rounds_.size() > Edit::MAX_POSITION) {
+        if (out_) {
+            *out_ << "Too many rounds." << std::endl;
+        }
         return;
-    } else if (fan >= fan_to_score_.rbegin()->first) {
-        std::cout << "Sick max yo." << std::endl;
     }
 
-    // Add result
-    results_.push_back(Result{
-        winning_player,
-        self_draw,
-        fan,
-        losing_player,
-        gong_direct,
-    });
+    Round round;
+    round.winning_player = static_cast<std::uint8_t>(winning_player);
+    round.losing_player = static_cast<std::uint8_t>(losing_player);
+    round.fan = static_cast<std::uint8_t>(fan);
+    round.flags = (self_draw ? Round::SELF_DRAW : 0) | (gong_direct ? Round::GONG_DIRECT : 0);
+    rounds_.push_back(round);
+    live_.push_back(true);
 
     // Add score
-    std::vector<int> score_set;
-    for (std::size_t i = 0; i < static_cast<std::size_t>(player_count_); ++i) {
-        if (i == winning_player && self_draw) {
-            // Win by self-draw
-            score_set.push_back((player_count_ - 1) * score);
-        } else if (i == winning_player) {
-            // Regular win
-            score_set.push_back(score);
-        } else if (i == losing_player && gong_direct) {
-            // Lose by gong-direct
-            score_set.push_back((player_count_ - 1) * -score);
-        } else if (i == losing_player || (self_draw && !gong_direct)) {
-            // Regular loss
-            score_set.push_back(-score);
-        } else {
-            score_set.push_back(0);
+    int score_set[MAX_PLAYERS];
+    (this->*apply_scores_)(round, 1, score_set);
+    stats_.add(round, score_set);
+
+    // Display human-readable result and scores unless running quietly
+    if (out_) {
+        *out_ << human_readable_result(rounds_.size() - 1) << std::endl;
+        print_scores();
+    }
+
+    record(Edit::Kind::Add, rounds_.size() - 1);
+    check_totals();
+}
+
+/**
+ * Work out score changes for a round
+ * @param round Round to score
+ * @param scores Filled with one score change per player
+ */
+void PureHonours::round_scores(const Round &round, int *scores) const
+{
+    (this->*round_scores_)(round, scores);
+}
+
+/**
+ * Work out score changes for a round at a table of N players
+ * @param round Round to score
+ * @param scores Filled with one score change per player
+ */
+template <std::size_t N>
+void PureHonours::round_scores_for(const Round &round, int *scores) const
+{
+    const scoring::FanLookup lookup(fan_table_, self_draw_table_);
+    const auto row = scoring::score_row<N>(round, lookup(round));
+    std::copy(row.begin(), row.end(), scores);
+}
+
+/**
+ * Add or subtract a round's score changes from the running totals
+ * @param round Round to apply
+ * @param sign 1 to add the round, -1 to take it away
+ * @param scores Filled with the round's score changes
+ */
+template <std::size_t N>
+void PureHonours::apply_scores_for(const Round &round, int sign, int *scores)
+{
+    const scoring::FanLookup lookup(fan_table_, self_draw_table_);
+    const auto row = scoring::score_row<N>(round, lookup(round));
+    for (std::size_t i = 0; i < N; ++i) {
+        totals_[i] += sign * row[i];
+        scores[i] = row[i];
+    }
+}
+
+/**
+ * Tally player scores at a table of N players
+ * @return Total for each player
+ */
+template <std::size_t N>
+std::vector<int> PureHonours::tally_for() const
+{
+    // Sum what everyone pays once per round, then adjust the winner and loser
+    // by how far their share differs from it
+    const scoring::FanLookup lookup(fan_table_, self_draw_table_);
+    std::array<int, N + 1> tally; // Last slot absorbs out-of-range seats
+    tally.fill(0);
+    int rest = 0;
+    for (auto &round : rounds_) {
+        if (round.deleted()) {
+            continue;
         }
+
+        const auto share = scoring::shares<N>(round, lookup(round));
+        const std::size_t winner = std::min<std::size_t>(round.winning_player, N);
+        const std::size_t loser = std::min<std::size_t>(round.losing_player, N);
+        rest += share.rest;
+        tally[loser] += (share.lose - share.rest) * (loser != winner);
+        tally[winner] += share.win - share.rest;
     }
-    scores_.push_back(score_set);
 
-    // Display human-readable result if non-empty (should never be empty)
-    if (!results_.empty()) {
-        std::cout << human_readable_result(results_.size() - 1) << std::endl;
+    std::vector<int> totals(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        totals[i] = tally[i] + rest;
     }
 
-    // Print scores
-    print_scores();
+    return totals;
 }
 
 /**
@@ -167,44 +537,51 @@ void PureHonours::add_result(std::size_t winning_player,
  */
 std::string PureHonours::human_readable_result(std::size_t count) const
 {
-    auto result = results_.at(count);
+    if (count >= rounds_.size()) {
+        throw std::out_of_range("No such result");
+    }
 
-    std::stringstream ss;
-    ss << player_names_.at(result.winning_player)
-       << " wins " << result.fan << " fan ";
-
-    if (result.self_draw && !result.gong_direct) {
-        ss << std::string("by self draw (") << fan_score(result.fan, true) << " from all).";
-    } else if (result.self_draw) {
-        ss << std::string("by self draw (")
-           << (fan_score(result.fan, true) * (player_count_ - 1))
-           << ") off a gong from "
-           << player_names_.at(result.losing_player) << ".";
-    } else {
-        ss << "from " << player_names_.at(result.losing_player)
-           << " (" << fan_score(result.fan) << ").";
+    std::string text;
+    {
+        StringSink sink(text);
+        OutputBuffer out(sink, 128);
+        append_result(out, count);
     }
 
-    return ss.str();
+    return text;
 }
 
 /**
- * Get index of a player
- * @param player_name Player initials
- * @return Index of player in arrays; returns size if failed
+ * Format a result in human-readable form without allocating
+ * @param out Buffer to append to
+ * @param count Index of the result
  */
-std::size_t PureHonours::player_index(const std::string &player_name) const
+void PureHonours::append_result(OutputBuffer &out, std::size_t count) const
 {
-    std::size_t index = 0;
-    while (index < player_names_.size()) {
-        if (player_names_[index] == player_name) {
-            return index;
-        }
+    const auto &result = rounds_[count];
 
-        ++index;
-    }
+    out.put(player_names_[result.winning_player]);
+    out.put(" wins ", 6);
+    out.put_int(result.fan);
+    out.put(" fan ", 5);
 
-    return index;
+    if (result.self_draw() && !result.gong_direct()) {
+        out.put("by self draw (", 14);
+        out.put_int(fan_score(result.fan, true));
+        out.put(" from all).", 11);
+    } else if (result.self_draw()) {
+        out.put("by self draw (", 14);
+        out.put_int(fan_score(result.fan, true) * (player_count_ - 1));
+        out.put(") off a gong from ", 18);
+        out.put(player_names_[result.losing_player]);
+        out.put('.');
+    } else {
+        out.put("from ", 5);
+        out.put(player_names_[result.losing_player]);
+        out.put(" (", 2);
+        out.put_int(fan_score(result.fan));
+        out.put(").", 2);
+    }
 }
 
 /**
@@ -213,16 +590,50 @@ std::size_t PureHonours::player_index(const std::string &player_name) const
  */
 std::vector<int> PureHonours::tally() const
 {
-    const std::size_t len = player_names_.size();
-    std::vector<int> tally(len, 0);
+    return (this->*tally_)();
+}
 
-    for (auto &set : scores_) {
-        for (std::size_t i = 0; i < len; ++i) {
-            tally[i] += set[i];
-        }
+/**
+ * Get running scores over a range of rounds
+ * @param first First round (1-based)
+ * @param last Last round (clamped to the number of rounds)
+ * @return Span of the rounds, counting from 0 at the start of the first;
+ *         empty if the range holds no rounds
+ */
+ScoreSpan PureHonours::score_span(std::size_t first, std::size_t last) const
+{
+    last = std::min(last, round_count());
+    if (first == 0 || first > last) {
+        return ScoreSpan();
+    }
+
+    update_tree();
+    const auto begin = live_.select(first);
+    const auto end = live_.select(last) + 1;
+
+    // Whole blocks come from the tree, partial ones at either end are summed
+    const auto block = ScoreTree::BLOCK;
+    const auto first_block = (begin + block - 1) / block;
+    const auto last_block = end / block;
+    if (first_block >= last_block) {
+        return stored_span(begin, end);
     }
 
-    return tally;
+    auto span = stored_span(begin, first_block * block);
+    span.append(score_tree_.query(first_block, last_block));
+    span.append(stored_span(last_block * block, end));
+    return span;
+}
+
+/**
+ * Verify running totals and statistics against a full recompute (debug builds only)
+ */
+void PureHonours::check_totals() const
+{
+#ifdef PUREHONOURS_CHECK_TOTALS
+    assert(totals_ == tally());
+    assert(stats_ == Statistics::compute(columns(), static_cast<int>(player_names_.size())));
+#endif
 }
 
 /**
@@ -230,14 +641,53 @@ std::vector<int> PureHonours::tally() const
  */
 void PureHonours::print_scores() const
 {
-    const std::size_t len = player_names_.size();
-    auto scores = tally();
+    if (!out_) {
+        return;
+    }
 
+    const std::size_t len = player_names_.size();
     for (std::size_t i = 0; i < len; ++i) {
-        std::cout << player_names_[i] << ": " << scores[i] << std::endl;
+        *out_ << player_names_[i] << ": " << totals_[i] << std::endl;
     }
 }
 
+/**
+ * Output per-player statistics
+ */
+void PureHonours::print_statistics() const
+{
+    if (!out_) {
+        return;
+    }
+
+    const auto flags = out_->flags();
+    const auto precision = out_->precision();
+
+    *out_ << std::left << std::setw(8) << "Player"
+          << std::setw(8) << "Wins"
+          << std::setw(8) << "Win%"
+          << std::setw(8) << "Self%"
+          << std::setw(10) << "Avg fan"
+          << std::setw(10) << "Max fan"
+          << std::setw(16) << "Fed (pts)"
+          << "Gong (pts)" << std::endl;
+
+    *out_ << std::fixed << std::setprecision(1);
+    for (std::size_t i = 0; i < player_names_.size(); ++i) {
+        const auto &player = stats_.player(i);
+        *out_ << std::setw(8) << player_names_[i]
+              << std::setw(8) << player.wins
+              << std::setw(8) << stats_.win_rate(i) * 100
+              << std::setw(8) << stats_.self_draw_rate(i) * 100
+              << std::setw(10) << stats_.average_fan(i)
+              << std::setw(10) << player.max_fan()
+              << std::setw(16) << (std::to_string(player.fed_count) + " (" + std::to_string(player.fed_points) + ")")
+              << player.gong_count << " (" << player.gong_points << ")" << std::endl;
+    }
+    out_->flags(flags);
+    out_->precision(precision);
+}
+
 /**
  * Use default set of fans
  */
@@ -246,25 +696,32 @@ void PureHonours::default_fans()
     // Clear if any exists
     if (!fan_to_score_.empty()) {
         fan_to_score_.clear();
-        std::cout << "Cleared existing fan/score pairs." << std::endl;
-    }
-
-    static const std::vector<std::pair<int, int>> values = {
-        {3, 32},
-        {4, 48},
-        {5, 64},
-        {6, 96},
-        {7, 128},
-        {8, 192},
-        {9, 256},
-        {10, 384},
-        {11, 512},
-        {12, 768},
-        {13, 1024},
-    };
+        if (out_) {
+            *out_ << "Cleared existing fan/score pairs." << std::endl;
+        }
+    }
 
-    for (auto &p : values) {
-        add_fan_score(p.first, p.second);
+    for (std::size_t fan = 0; fan < fans::DEFAULT_SIZE; ++fan) {
+        if (fans::DEFAULT_SCORES[fan] != 0) {
+            set_fan_score(static_cast<int>(fan), fans::DEFAULT_SCORES[fan]);
+        }
+    }
+
+    // Lookup tables come straight from the compiled-in defaults
+    fan_table_.assign(fans::DEFAULT_SCORES, fans::DEFAULT_SCORES + fans::DEFAULT_SIZE);
+    switch (player_count_) {
+    case 2:
+        self_draw_table_.assign(fans::DefaultSelfDraw<2>::SCORES,
+                                fans::DefaultSelfDraw<2>::SCORES + fans::DEFAULT_SIZE);
+        break;
+    case 3:
+        self_draw_table_.assign(fans::DefaultSelfDraw<3>::SCORES,
+                                fans::DefaultSelfDraw<3>::SCORES + fans::DEFAULT_SIZE);
+        break;
+    default:
+        self_draw_table_.assign(fans::DefaultSelfDraw<4>::SCORES,
+                                fans::DefaultSelfDraw<4>::SCORES + fans::DEFAULT_SIZE);
+        break;
     }
 }
 
@@ -273,64 +730,153 @@ void PureHonours::default_fans()
  */
 void PureHonours::print_report() const
 {
-    // Print title
-    std::cout << '+' << std::string(report::ROUND_WIDTH, '-');
-    for (auto i = 0; i < player_count_; ++i) {
-        std::cout << '+' << std::string(report::COLUMN_WIDTH, '-');
+    print_report(1, round_count());
+}
+
+/**
+ * Print each player's score after a range of rounds, with how far it rose
+ * and fell along the way
+ * @param first First round (1-based)
+ * @param last Last round (clamped to the number of rounds)
+ */
+void PureHonours::print_standings(std::size_t first, std::size_t last) const
+{
+    METRICS_TIME(Report);
+
+    if (!out_) {
+        return;
+    }
+
+    const auto rounds = round_count();
+    last = std::min(last, rounds);
+    if (first == 0 || first > last) {
+        *out_ << "No rounds to show." << std::endl;
+        return;
     }
-    std::cout << '+' << std::endl;
 
-    std::cout << '|' << report::centre_pad("Round", report::ROUND_WIDTH) << '|';
+    const auto before = score_span(1, first - 1);
+    const auto span = score_span(first, last);
+    if (first == 1) {
+        *out_ << "After round " << last << " of " << rounds << ":" << std::endl;
+    } else {
+        *out_ << "Rounds " << first << "-" << last << " of " << rounds << ":" << std::endl;
+    }
+
+    // Peaks and troughs are running scores, starting from the score before the range
+    const auto flags = out_->flags();
+    *out_ << std::left << std::setw(8) << "Player"
+          << std::setw(10) << "Score"
+          << std::setw(10) << "Change"
+          << std::setw(10) << "Peak"
+          << std::setw(10) << "Trough"
+          << "Drawdown" << std::endl;
     for (std::size_t i = 0; i < player_names_.size(); ++i) {
-        std::cout << report::centre_pad(player_names_[i]) << '|';
+        const int start = before.total[i];
+        *out_ << std::setw(8) << player_names_[i]
+              << std::setw(10) << start + span.total[i]
+              << std::setw(10) << span.total[i]
+              << std::setw(10) << start + span.peak[i]
+              << std::setw(10) << start + span.trough[i]
+              << span.drawdown[i] << std::endl;
     }
-    std::cout << std::endl;
+    out_->flags(flags);
+}
+
+/**
+ * Print score report as a table, showing only some rounds
+ * @param first First round to show (1-based)
+ * @param last Last round to show (clamped to the number of rounds)
+ */
+void PureHonours::print_report(std::size_t first, std::size_t last) const
+{
+    METRICS_TIME(Report);
 
-    std::cout << '+' << std::string(report::ROUND_WIDTH, '-');
-    for (auto i = 0; i < player_count_; ++i) {
-        std::cout << '+' << std::string(report::COLUMN_WIDTH, '-');
+    if (!out_) {
+        return;
     }
-    std::cout << '+' << std::endl;
 
-    // Print rows
-    for (std::size_t i = 0; i < scores_.size(); ++i) {
+    const std::size_t rounds = round_count();
+    first = std::max<std::size_t>(first, 1);
+    last = std::min(last, rounds);
+    const std::size_t rows = last >= first ? last - first + 1 : 0;
+    const bool windowed = rows != rounds;
+
+    // Size the buffer for the rows shown so the table goes out in one write
+    const std::size_t line = report::ROUND_WIDTH + 3 + player_count_ * (report::COLUMN_WIDTH + 1);
+    StreamSink sink(*out_);
+    OutputBuffer out(sink, std::min((rows + 8) * line, report::MAX_BUFFER));
+
+    // Print title
+    report::put_rule(out, player_count_);
+    out.put('|');
+    report::put_centred(out, "Round", 5, report::ROUND_WIDTH);
+    out.put('|');
+    for (std::size_t i = 0; i < player_names_.size(); ++i) {
+        report::put_centred(out, player_names_[i]);
+        out.put('|');
+    }
+    out.put('\n');
+    report::put_rule(out, player_count_);
+
+    // Print rows, numbering live rounds only
+    int score_set[MAX_PLAYERS];
+    std::size_t position = rows > 0 ? live_.select(first) : rounds_.size();
+    for (std::size_t number = first; rows > 0 && number <= last; ++position) {
+        if (rounds_[position].deleted()) {
+            continue;
+        }
+
         // Print round number
-        const auto &score_set = scores_[i];
-        std::cout << '|' << report::centre_pad(std::to_string(i + 1), report::ROUND_WIDTH) << '|';
+        round_scores(rounds_[position], score_set);
+        out.put('|');
+        report::put_centred(out, static_cast<long long>(number++), report::ROUND_WIDTH);
+        out.put('|');
 
         // Print scores
-        for (auto &score : score_set) {
-            if (score == 0) {
-                std::cout << std::string(report::COLUMN_WIDTH, ' ');
+        for (auto j = 0; j < player_count_; ++j) {
+            if (score_set[j] == 0) {
+                out.put_repeat(' ', report::COLUMN_WIDTH);
             } else {
-                std::cout << report::centre_pad(std::to_string(score));
+                report::put_centred(out, score_set[j]);
             }
-            std::cout << '|';
+            out.put('|');
         }
-        std::cout << std::endl;
+        out.put('\n');
     }
 
-    // If we printed at least one row, print an extra row
-    if (!scores_.empty()) {
-        std::cout << '+' << std::string(report::ROUND_WIDTH, '-');
-        for (auto i = 0; i < player_count_; ++i) {
-            std::cout << '+' << std::string(report::COLUMN_WIDTH, '-');
-        }
-        std::cout << '+' << std::endl;
+    // If there is at least one round, print an extra row
+    if (rounds > 0) {
+        report::put_rule(out, player_count_);
 
         // Print totals
-        std::cout << '|' << report::centre_pad("Sum", report::ROUND_WIDTH) << '|';
-        for (auto &total : tally()) {
-            std::cout << report::centre_pad(std::to_string(total)) << '|';
+        out.put('|');
+        report::put_centred(out, "Sum", 3, report::ROUND_WIDTH);
+        out.put('|');
+        for (auto &total : totals_) {
+            report::put_centred(out, total);
+            out.put('|');
         }
-        std::cout << std::endl;
+        out.put('\n');
+        report::put_rule(out, player_count_);
+    }
 
-        std::cout << '+' << std::string(report::ROUND_WIDTH, '-');
-        for (auto i = 0; i < player_count_; ++i) {
-            std::cout << '+' << std::string(report::COLUMN_WIDTH, '-');
+    if (windowed) {
+        out.put("Showing ", 8);
+        if (rows == 0) {
+            out.put("no rounds", 9);
+        } else {
+            out.put("rounds ", 7);
+            out.put_int(static_cast<long long>(first));
+            out.put('-');
+            out.put_int(static_cast<long long>(last));
         }
-        std::cout << '+' << std::endl;
+        out.put(" of ", 4);
+        out.put_int(static_cast<long long>(rounds));
+        out.put(".\n", 2);
     }
+
+    out.flush();
+    out_->flush();
 }
 
 /**
@@ -338,54 +884,140 @@ void PureHonours::print_report() const
  */
 void PureHonours::print_csv() const
 {
-    // Generate file object
-    auto name = filename() + ".csv";
-    try {
-        auto file = std::ofstream(name, std::ios_base::out | std::ios_base::trunc);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file for writing: " << name << std::endl;
+    auto name = export_filename() + ".csv";
+    if (!save_csv(name)) {
+        std::cerr << "Failed to write file: " << name << std::endl;
+        return;
+    }
+
+    if (out_) {
+        *out_ << "Saved to: " << name << std::endl;
+    }
+}
+
+/**
+ * Write the CSV report to a file
+ * @param name Path to write to
+ * @return True if successful, false otherwise
+ */
+bool PureHonours::save_csv(const std::string &name) const
+{
+    int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool written = false;
+    {
+        FdSink sink(fd);
+        OutputBuffer out(sink);
+        write_csv(out);
+        written = out.flush();
+    }
+
+    return ::close(fd) == 0 && written;
+}
+
+/**
+ * Stream the CSV report into a buffer
+ * @param out Buffer to write to
+ */
+void PureHonours::write_csv(OutputBuffer &out) const
+{
+    METRICS_TIME(Csv);
+
+    write_csv_header(out);
+    write_csv_rows(out, 0);
+}
+
+/**
+ * Write the CSV title row
+ * @param out Buffer to write to
+ */
+void PureHonours::write_csv_header(OutputBuffer &out) const
+{
+    out.put("Round", 5);
+    for (auto &name : player_names_) {
+        out.put(',');
+        out.put(name);
+    }
+    out.put(",Notes\n", 7);
+}
+
+/**
+ * Write CSV rows for live rounds after the first few
+ * @param out Buffer to write to
+ * @param skip Live rounds to leave out
+ * @param starts If given, each row's position in out is appended to it
+ */
+void PureHonours::write_csv_rows(OutputBuffer &out,
+                                 std::size_t skip,
+                                 std::vector<std::size_t> *starts) const
+{
+    if (skip >= round_count()) {
+        return;
+    }
+
+    // Print scores, numbering live rounds only
+    int score_set[MAX_PLAYERS];
+    std::size_t number = skip;
+    for (std::size_t i = live_.select(skip + 1); i < rounds_.size(); ++i) {
+        if (rounds_[i].deleted()) {
+            continue;
         }
 
-        // Print title row
-        file << "Round";
-        for (auto &name : player_names_) {
-            file << "," << name;
+        if (starts) {
+            starts->push_back(out.position());
         }
-        file << ",Notes" << std::endl;
 
-        // Print scores
-        for (std::size_t i = 0; i < scores_.size(); ++i) {
-            const auto &score_set = scores_[i];
-            file << (i + 1);
-
-            for (auto &score : score_set) {
-                file << ",";
-                if (score != 0) {
-                    file << score;
-                }
-            }
+        round_scores(rounds_[i], score_set);
+        out.put_int(static_cast<long long>(++number));
 
-            file << "," << human_readable_result(i) << std::endl;
+        for (auto j = 0; j < player_count_; ++j) {
+            out.put(',');
+            if (score_set[j] != 0) {
+                out.put_int(score_set[j]);
+            }
         }
 
-        // Finished with file
-        file.close();
-    } catch (...) {
-        throw;
+        out.put(',');
+        append_result(out, i);
+        out.put('\n');
+    }
+}
+
+/**
+ * Export results as a binary session file
+ */
+void PureHonours::export_file() const
+{
+    METRICS_TIME(Export);
+
+    auto name = export_filename() + ".phs";
+    if (!session_file::write(name, *this)) {
+        std::cerr << "Failed to write file: " << name << std::endl;
+        return;
     }
 
-    std::cout << "Saved to: " << name << std::endl;
+    if (out_) {
+        *out_ << "Saved to: " << name << std::endl;
+    }
 }
 
 /**
- * Delete an entered score
- * @param index Index to delete
+ * Delete an entered score, leaving a tombstone so it can be undone
+ * @param index Index to delete, counting live rounds from 1
+ * @return True if successful, false otherwise
  */
 bool PureHonours::delete_score(std::size_t index)
 {
-    if (index > 0 && index <= scores_.size()) {
-        scores_.erase(scores_.begin() + index - 1);
-        results_.erase(results_.begin() + index - 1);
+    METRICS_TIME(DeleteScore);
+
+    if (index > 0 && index <= round_count()) {
+        const auto position = live_.select(index);
+        set_deleted(position, true);
+        record(Edit::Kind::Delete, position);
+        check_totals();
 
         return true;
     }
@@ -399,14 +1031,285 @@ bool PureHonours::delete_score(std::size_t index)
  */
 bool PureHonours::delete_score()
 {
-    return delete_score(scores_.size());
+    return delete_score(round_count());
+}
+
+/**
+ * Reverse the most recent add or delete
+ * @return True if successful, false if there is nothing to undo
+ */
+bool PureHonours::undo()
+{
+    METRICS_TIME(Undo);
+
+    if (undo_.empty()) {
+        return false;
+    }
+
+    const auto edit = undo_.back();
+    undo_.pop_back();
+    set_deleted(edit.position(), edit.kind() == Edit::Kind::Add);
+    redo_.push_back(edit);
+    check_totals();
+
+    print_change(edit.kind() == Edit::Kind::Add ? "Removed" : "Restored", edit.position());
+    return true;
+}
+
+/**
+ * Reapply the most recently undone change
+ * @return True if successful, false if there is nothing to redo
+ */
+bool PureHonours::redo()
+{
+    METRICS_TIME(Undo);
+
+    if (redo_.empty()) {
+        return false;
+    }
+
+    const auto edit = redo_.back();
+    redo_.pop_back();
+    set_deleted(edit.position(), edit.kind() == Edit::Kind::Delete);
+    undo_.push_back(edit);
+    check_totals();
+
+    print_change(edit.kind() == Edit::Kind::Add ? "Restored" : "Removed", edit.position());
+    return true;
+}
+
+/**
+ * Replace every round and the undo history, e.g. when loading a saved game
+ * @param rounds Rounds including tombstones
+ * @param undo Changes that can be undone, oldest first
+ * @param redo Changes that can be redone, oldest first
+ * @return True if successful, false if an edit points past the rounds
+ */
+bool PureHonours::restore(std::vector<Round> &&rounds,
+                          std::vector<Edit> &&undo,
+                          std::vector<Edit> &&redo)
+{
+    std::vector<char> referenced(rounds.size(), 0);
+    for (auto stack : {&undo, &redo}) {
+        for (auto &edit : *stack) {
+            if (edit.position() >= rounds.size()) {
+                return false;
+            }
+            referenced[edit.position()] = 1;
+        }
+    }
+
+    rounds_ = std::move(rounds);
+    undo_ = std::move(undo);
+    redo_ = std::move(redo);
+
+    live_.clear();
+    garbage_ = 0;
+    unchanged_ = 0;
+    score_tree_.clear();
+    tree_rounds_ = 0;
+    for (std::size_t i = 0; i < rounds_.size(); ++i) {
+        live_.push_back(!rounds_[i].deleted());
+        if (rounds_[i].deleted() && !referenced[i]) {
+            ++garbage_;
+        }
+    }
+
+    totals_ = tally();
+    stats_ = Statistics::compute(columns(), static_cast<int>(player_names_.size()));
+    check_totals();
+    return true;
+}
+
+/**
+ * Tombstone or revive a round, keeping totals and statistics in step
+ * @param position Index into the stored rounds
+ * @param deleted Whether the round should be deleted
+ */
+void PureHonours::set_deleted(std::size_t position, bool deleted)
+{
+    auto &round = rounds_[position];
+    if (round.deleted() == deleted) {
+        return;
+    }
+
+    int score_set[MAX_PLAYERS];
+    (this->*apply_scores_)(round, deleted ? -1 : 1, score_set);
+
+    if (deleted) {
+        stats_.remove(round, score_set);
+        round.flags |= Round::DELETED;
+    } else {
+        stats_.add(round, score_set);
+        round.flags &= ~Round::DELETED;
+    }
+    live_.set(position, !deleted);
+
+    // Live rounds from here on are renumbered or changed
+    unchanged_ = std::min(unchanged_, live_.rank(position));
+
+    // Rounds the tree has not reached yet are summed when it catches up
+    if (position < tree_rounds_) {
+        const auto block = position / ScoreTree::BLOCK;
+        const auto first = block * ScoreTree::BLOCK;
+        score_tree_.set(block, stored_span(first, std::min(first + ScoreTree::BLOCK, rounds_.size())));
+    }
+}
+
+/**
+ * Sum running scores over stored rounds, skipping deleted ones
+ * @param first First stored round (0-based)
+ * @param last One past the last stored round
+ * @return Span of the rounds
+ */
+ScoreSpan PureHonours::stored_span(std::size_t first, std::size_t last) const
+{
+    ScoreSpan span;
+    int score_set[ScoreSpan::SEATS] = {};
+    for (std::size_t i = first; i < last; ++i) {
+        if (!rounds_[i].deleted()) {
+            round_scores(rounds_[i], score_set);
+            span.add(score_set);
+        }
+    }
+
+    return span;
+}
+
+/**
+ * Add blocks for rounds entered since the tree was last used
+ */
+void PureHonours::update_tree() const
+{
+    const auto block = ScoreTree::BLOCK;
+    for (auto i = tree_rounds_ / block; i * block < rounds_.size(); ++i) {
+        score_tree_.set(i, stored_span(i * block, std::min((i + 1) * block, rounds_.size())));
+    }
+    tree_rounds_ = rounds_.size();
+}
+
+/**
+ * Push a new change onto the undo history
+ * @param kind Kind of change
+ * @param position Index into the stored rounds
+ */
+void PureHonours::record(Edit::Kind kind, std::size_t position)
+{
+    // Rounds whose add was undone can no longer come back
+    for (auto &edit : redo_) {
+        if (edit.kind() == Edit::Kind::Add) {
+            ++garbage_;
+        }
+    }
+    redo_.clear();
+
+    undo_.push_back(Edit(kind, position));
+    if (undo_.size() >= 2 * UNDO_DEPTH) {
+        forget(undo_.size() - UNDO_DEPTH);
+    }
+
+    if (garbage_ >= history::COMPACT_MIN &&
+        garbage_ * history::COMPACT_RATIO >= rounds_.size()) {
+        compact();
+    }
+}
+
+/**
+ * Drop the oldest changes from the undo history
+ *
+ * Rounds deleted by a dropped change can never come back unless a change
+ * still in the history refers to them, so they count towards compaction.
+ * @param count Number of changes to drop
+ */
+void PureHonours::forget(std::size_t count)
+{
+    std::vector<std::size_t> kept;
+    kept.reserve(undo_.size() - count + redo_.size());
+    for (std::size_t i = count; i < undo_.size(); ++i) {
+        kept.push_back(undo_[i].position());
+    }
+    for (auto &edit : redo_) {
+        kept.push_back(edit.position());
+    }
+    std::sort(kept.begin(), kept.end());
+
+    std::vector<std::size_t> dropped;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (rounds_[undo_[i].position()].deleted()) {
+            dropped.push_back(undo_[i].position());
+        }
+    }
+    std::sort(dropped.begin(), dropped.end());
+    dropped.erase(std::unique(dropped.begin(), dropped.end()), dropped.end());
+
+    for (auto position : dropped) {
+        if (!std::binary_search(kept.begin(), kept.end(), position)) {
+            ++garbage_;
+        }
+    }
+
+    undo_.erase(undo_.begin(), undo_.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+/**
+ * Drop tombstones that no undo or redo can reach and renumber the history
+ */
+void PureHonours::compact()
+{
+    std::vector<char> referenced(rounds_.size(), 0);
+    for (auto stack : {&undo_, &redo_}) {
+        for (auto &edit : *stack) {
+            referenced[edit.position()] = 1;
+        }
+    }
+
+    std::vector<std::size_t> moved(rounds_.size());
+    std::size_t kept = 0;
+    live_.clear();
+    for (std::size_t i = 0; i < rounds_.size(); ++i) {
+        if (rounds_[i].deleted() && !referenced[i]) {
+            continue;
+        }
+
+        moved[i] = kept;
+        rounds_[kept++] = rounds_[i];
+        live_.push_back(!rounds_[i].deleted());
+    }
+    rounds_.resize(kept);
+
+    for (auto stack : {&undo_, &redo_}) {
+        for (auto &edit : *stack) {
+            edit = Edit(edit.kind(), moved[edit.position()]);
+        }
+    }
+
+    garbage_ = 0;
+
+    // Positions have moved; rebuild the tree when it is next needed
+    score_tree_.clear();
+    tree_rounds_ = 0;
+}
+
+/**
+ * Show a round that was removed or restored, then the scores
+ * @param action What happened to the round
+ * @param position Index into the stored rounds
+ */
+void PureHonours::print_change(const char *action, std::size_t position) const
+{
+    if (!out_) {
+        return;
+    }
+
+    *out_ << action << ": " << human_readable_result(position) << std::endl;
+    print_scores();
 }
 
 /**
  * Generate filename for export using players
  * @return Filename for export
  */
-const std::string PureHonours::filename() const
+const std::string PureHonours::export_filename() const
 {
     using sc = std::chrono::system_clock;
 
@@ -438,3 +1341,132 @@ const std::string PureHonours::history_filename() const
 
     return ss.str();
 }
+
+/**
+ * Redirect game output
+ * @param out Stream to write to, or nullptr to run quietly
+ */
+void PureHonours::set_output(std::ostream *out)
+{
+    out_ = out;
+}
+
+/**
+ * Get number of players
+ * @return Number of players
+ */
+int PureHonours::player_count() const
+{
+    return player_count_;
+}
+
+/**
+ * Get player initials
+ * @return Initials of players in seat order
+ */
+const std::vector<std::string> &PureHonours::player_names() const
+{
+    return player_names_;
+}
+
+/**
+ * Get fan/score table
+ * @return Map of fan to score
+ */
+const std::map<int, int> &PureHonours::fan_scores() const
+{
+    return fan_to_score_;
+}
+
+/**
+ * Get stored rounds
+ * @return Rounds in order, including deleted rounds kept for undo
+ */
+const std::vector<Round> &PureHonours::rounds() const
+{
+    return rounds_;
+}
+
+/**
+ * Get number of rounds that have not been deleted
+ * @return Number of live rounds
+ */
+std::size_t PureHonours::round_count() const
+{
+    return live_.count();
+}
+
+/**
+ * Get changes that can be undone
+ * @return Changes, oldest first
+ */
+const std::vector<Edit> &PureHonours::undo_history() const
+{
+    return undo_;
+}
+
+/**
+ * Get changes that can be redone
+ * @return Changes, oldest first
+ */
+const std::vector<Edit> &PureHonours::redo_history() const
+{
+    return redo_;
+}
+
+/**
+ * Count leading live rounds that have not changed since the last export
+ * @return Number of live rounds, from the first, still as last exported
+ */
+std::size_t PureHonours::unchanged_rounds() const
+{
+    return unchanged_;
+}
+
+/**
+ * Note that every live round as it stands has been exported
+ */
+void PureHonours::mark_exported()
+{
+    unchanged_ = round_count();
+}
+
+/**
+ * Get running totals
+ * @return Total score of each player
+ */
+const std::vector<int> &PureHonours::totals() const
+{
+    return totals_;
+}
+
+/**
+ * Get per-player statistics
+ * @return Statistics kept up to date with the rounds
+ */
+const Statistics &PureHonours::statistics() const
+{
+    return stats_;
+}
+
+/**
+ * Copy the rounds into columns for bulk aggregation
+ * @return Rounds stored by column
+ */
+RoundColumns PureHonours::columns() const
+{
+    RoundColumns columns;
+    columns.reserve(round_count());
+
+    int score_set[MAX_PLAYERS];
+    for (auto &round : rounds_) {
+        if (round.deleted()) {
+            continue;
+        }
+
+        round_scores(round, score_set);
+        columns.append(round, score_set);
+    }
+
+    return columns;
+}
@@ -1,23 +1,85 @@
 #ifndef __PUREHONOURS_H
 #define __PUREHONOURS_H
 
+#include "live_index.h"
+#include "score_tree.h"
+#include "statistics.h"
+
 #include <cstddef>
+#include <cstdint>
+#include <iosfwd>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
-struct Result {
-    std::size_t winning_player;
-    bool self_draw;
-    int fan;
-    std::size_t losing_player;
-    bool gong_direct;
+class OutputBuffer;
+
+// Maximum number of players at a table
+const std::size_t MAX_PLAYERS = 4;
+
+// Highest fan a round can record, as Round::fan is a byte; larger fans are
+// rejected rather than scored as this
+const int MAX_FAN = 255;
+
+// Changes that can always be undone; the oldest are forgotten in batches of
+// this many so the rounds they deleted can be compacted away
+const std::size_t UNDO_DEPTH = 4096;
+
+static_assert(ScoreSpan::SEATS >= MAX_PLAYERS, "ScoreSpan must have a seat for every player");
+
+/**
+ * One entered round; score deltas are derived from it and the fan table
+ *
+ * Deleted rounds stay in place as tombstones so they can be restored.
+ */
+struct Round {
+    static const std::uint8_t SELF_DRAW = 1;
+    static const std::uint8_t GONG_DIRECT = 2;
+    static const std::uint8_t DELETED = 4;
+
+    std::uint8_t winning_player;
+    std::uint8_t losing_player;
+    std::uint8_t fan;
+    std::uint8_t flags;
+
+    bool self_draw() const { return (flags & SELF_DRAW) != 0; }
+    bool gong_direct() const { return (flags & GONG_DIRECT) != 0; }
+    bool deleted() const { return (flags & DELETED) != 0; }
+};
+
+/**
+ * One undoable change to the rounds, packed into as little space as a Round
+ */
+struct Edit {
+    enum class Kind : std::uint8_t {
+        Add,
+        Delete,
+    };
+
+    // Largest index an edit can hold; the top bit is taken by the kind
+    static const std::uint32_t MAX_POSITION = 0x7fffffffu;
+
+    std::uint32_t bits; // Index into the stored rounds, tombstones included; Delete in the top bit
+
+    Edit() = default;
+    Edit(Kind kind, std::size_t position)
+    : bits(static_cast<std::uint32_t>(position) | (kind == Kind::Delete ? MAX_POSITION + 1u : 0u))
+    {
+    }
+
+    Kind kind() const { return bits > MAX_POSITION ? Kind::Delete : Kind::Add; }
+    std::size_t position() const { return bits & MAX_POSITION; }
 };
 
+static_assert(sizeof(Edit) == 4, "Edit should be packed into four bytes");
+
 class PureHonours {
 public:
     PureHonours(int player_count, std::vector<std::string> &&player_names);
 
+    std::unique_ptr<PureHonours> copy(bool with_edits) const;
+
     void add_fan_score(int fan, int score);
     void add_result(std::size_t winning_player,
                     int fan,
@@ -25,26 +87,93 @@ public:
                     std::size_t losing_player = 0,
                     bool gong_direct = false);
     std::string human_readable_result(std::size_t count) const;
+    void append_result(OutputBuffer &out, std::size_t count) const;
     void print_scores() const;
     bool delete_score();
     bool delete_score(std::size_t index);
+    bool undo();
+    bool redo();
+    bool restore(std::vector<Round> &&rounds,
+                 std::vector<Edit> &&undo,
+                 std::vector<Edit> &&redo);
     void print_report() const;
+    void print_report(std::size_t first, std::size_t last) const;
+    void print_standings(std::size_t first, std::size_t last) const;
     void print_csv() const;
+    bool save_csv(const std::string &name) const;
+    void write_csv(OutputBuffer &out) const;
+    void write_csv_header(OutputBuffer &out) const;
+    void write_csv_rows(OutputBuffer &out,
+                        std::size_t skip,
+                        std::vector<std::size_t> *starts = nullptr) const;
     void default_fans();
     void export_file() const;
+    const std::string export_filename() const;
     const std::string history_filename() const;
-    std::size_t player_index(const std::string &player_name) const;
+
+    void set_output(std::ostream *out);
+    int player_count() const;
+    const std::vector<std::string> &player_names() const;
+    const std::map<int, int> &fan_scores() const;
+    const std::vector<Round> &rounds() const;
+    std::size_t round_count() const;
+    const std::vector<Edit> &undo_history() const;
+    const std::vector<Edit> &redo_history() const;
+    std::size_t unchanged_rounds() const;
+    void mark_exported();
+    const std::vector<int> &totals() const;
+    const Statistics &statistics() const;
+    RoundColumns columns() const;
+    void print_statistics() const;
+    int fan_score(int fan, bool self_draw = false) const;
+    std::vector<int> tally() const;
+    ScoreSpan score_span(std::size_t first, std::size_t last) const;
 
 private:
+    std::ostream *out_;
     int player_count_;
     std::vector<std::string> player_names_;
-    std::vector<std::vector<int>> scores_;
     std::map<int, int> fan_to_score_;
-    std::vector<Result> results_;
+    std::vector<int> fan_table_;
+    std::vector<int> self_draw_table_;
+    std::vector<Round> rounds_;
+    LiveIndex live_;
+    std::vector<Edit> undo_;
+    std::vector<Edit> redo_;
+    std::size_t garbage_;
+    std::size_t unchanged_; // Leading live rounds untouched since mark_exported()
+    std::vector<int> totals_;
+    Statistics stats_;
 
-    int fan_score(int fan, bool self_draw = false) const;
-    std::vector<int> tally() const;
-    const std::string filename() const;
+    // Running scores by block of stored rounds, brought up to date when queried
+    mutable ScoreTree score_tree_;
+    mutable std::size_t tree_rounds_; // Stored rounds the tree covers
+
+    // Scoring kernels for the table's player count, picked at construction
+    void (PureHonours::*round_scores_)(const Round &round, int *scores) const;
+    void (PureHonours::*apply_scores_)(const Round &round, int sign, int *scores);
+    std::vector<int> (PureHonours::*tally_)() const;
+
+    template <std::size_t N>
+    void round_scores_for(const Round &round, int *scores) const;
+    template <std::size_t N>
+    void apply_scores_for(const Round &round, int sign, int *scores);
+    template <std::size_t N>
+    std::vector<int> tally_for() const;
+    template <std::size_t N>
+    void use_kernels();
+
+    void set_fan_score(int fan, int score);
+    void rebuild_fan_tables();
+    void round_scores(const Round &round, int *scores) const;
+    void set_deleted(std::size_t position, bool deleted);
+    ScoreSpan stored_span(std::size_t first, std::size_t last) const;
+    void update_tree() const;
+    void record(Edit::Kind kind, std::size_t position);
+    void forget(std::size_t count);
+    void compact();
+    void print_change(const char *action, std::size_t position) const;
+    void check_totals() const;
 };
 
 #endif // __PUREHONOURS_H
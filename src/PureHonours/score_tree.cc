@@ -0,0 +1,113 @@
+#include "score_tree.h"
+
+#include <algorithm>
+
+/**
+ * Extend the span by one round
+ * @param scores Score change of each seat in the round
+ */
+void ScoreSpan::add(const int *scores)
+{
+    for (std::size_t i = 0; i < SEATS; ++i) {
+        total[i] += scores[i];
+        peak[i] = std::max(peak[i], total[i]);
+        trough[i] = std::min(trough[i], total[i]);
+        drawdown[i] = std::max(drawdown[i], peak[i] - total[i]);
+    }
+}
+
+/**
+ * Extend the span by the run of rounds straight after it
+ * @param next Span of the following rounds
+ */
+void ScoreSpan::append(const ScoreSpan &next)
+{
+    for (std::size_t i = 0; i < SEATS; ++i) {
+        // A fall can start in this span and end in the next
+        drawdown[i] = std::max(std::max(drawdown[i], next.drawdown[i]),
+                               peak[i] - (total[i] + next.trough[i]));
+        peak[i] = std::max(peak[i], total[i] + next.peak[i]);
+        trough[i] = std::min(trough[i], total[i] + next.trough[i]);
+        total[i] += next.total[i];
+    }
+}
+
+/**
+ * Remove every block
+ */
+void ScoreTree::clear()
+{
+    capacity_ = 0;
+    nodes_.clear();
+}
+
+/**
+ * Replace the span of one block, growing the tree to hold it
+ * @param block Index of the block
+ * @param span Span of the rounds in the block
+ */
+void ScoreTree::set(std::size_t block, const ScoreSpan &span)
+{
+    if (block >= capacity_) {
+        grow(block + 1);
+    }
+
+    std::size_t node = capacity_ + block;
+    nodes_[node] = span;
+    for (node /= 2; node > 0; node /= 2) {
+        nodes_[node] = nodes_[2 * node];
+        nodes_[node].append(nodes_[2 * node + 1]);
+    }
+}
+
+/**
+ * Combine the spans of a run of blocks
+ * @param first First block
+ * @param last One past the last block
+ * @return Span of the blocks; empty if there are none
+ */
+ScoreSpan ScoreTree::query(std::size_t first, std::size_t last) const
+{
+    ScoreSpan left;
+    ScoreSpan right;
+    first = std::min(first, capacity_) + capacity_;
+    last = std::min(last, capacity_) + capacity_;
+
+    // Collect from both ends inwards; spans only combine in round order
+    for (; first < last; first /= 2, last /= 2) {
+        if (first & 1) {
+            left.append(nodes_[first++]);
+        }
+        if (last & 1) {
+            auto span = nodes_[--last];
+            span.append(right);
+            right = span;
+        }
+    }
+
+    left.append(right);
+    return left;
+}
+
+/**
+ * Double the leaves until they cover enough blocks, then rebuild the nodes
+ * @param blocks Blocks to cover
+ */
+void ScoreTree::grow(std::size_t blocks)
+{
+    std::size_t capacity = std::max<std::size_t>(capacity_, 1);
+    while (capacity < blocks) {
+        capacity *= 2;
+    }
+
+    std::vector<ScoreSpan> nodes(2 * capacity);
+    std::copy(nodes_.begin() + static_cast<std::ptrdiff_t>(capacity_), nodes_.end(),
+              nodes.begin() + static_cast<std::ptrdiff_t>(capacity));
+    for (std::size_t node = capacity - 1; node > 0; --node) {
+        nodes[node] = nodes[2 * node];
+        nodes[node].append(nodes[2 * node + 1]);
+    }
+
+    capacity_ = capacity;
+    nodes_.swap(nodes);
+}
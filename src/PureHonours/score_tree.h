@@ -0,0 +1,48 @@
+#ifndef __SCORE_TREE_H
+#define __SCORE_TREE_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Running scores over a run of rounds, for every seat
+ *
+ * Running scores count from 0 at the start of the run, so the peak is never
+ * below 0 and the trough never above it.
+ */
+struct ScoreSpan {
+    static const std::size_t SEATS = 4;
+
+    int total[SEATS] = {};
+    int peak[SEATS] = {};
+    int trough[SEATS] = {};
+    int drawdown[SEATS] = {}; // Largest fall from a running high to a later low
+
+    void add(const int *scores);
+    void append(const ScoreSpan &next);
+};
+
+/**
+ * Segment tree of score spans over fixed-size blocks of rounds
+ *
+ * Each leaf summarises BLOCK consecutive rounds, so the tree stays small
+ * next to the rounds themselves; any run of whole blocks is combined from
+ * O(log n) nodes, and changing one block touches O(log n) nodes.
+ */
+class ScoreTree {
+public:
+    // Rounds summarised by each leaf
+    static const std::size_t BLOCK = 32;
+
+    void clear();
+    void set(std::size_t block, const ScoreSpan &span);
+    ScoreSpan query(std::size_t first, std::size_t last) const;
+
+private:
+    std::size_t capacity_ = 0;      // Leaves, a power of two
+    std::vector<ScoreSpan> nodes_;  // nodes_[1] is the root; leaves start at capacity_
+
+    void grow(std::size_t blocks);
+};
+
+#endif // __SCORE_TREE_H
@@ -0,0 +1,464 @@
+#include "server.h"
+#include "tokens.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+// Events handled per epoll_wait call
+const int MAX_EVENTS = 256;
+
+// Bytes read per recv call
+const std::size_t READ_SIZE = 16 * 1024;
+
+// Longest line accepted before the connection is dropped
+const std::size_t MAX_LINE = 64 * 1024;
+
+// Unsent output past which a connection's input is left unread
+const std::size_t MAX_OUTPUT = 256 * 1024;
+
+// Line ending every response
+const char END_OF_RESPONSE[] = ".\n";
+
+/**
+ * Check whether an address is a TCP port
+ * @param address Port number or socket path
+ * @return True if every character is a digit, false otherwise
+ */
+bool is_port(const std::string &address)
+{
+    return !address.empty() &&
+           std::all_of(address.begin(), address.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+} // namespace
+
+Server::Server()
+: listen_fd_(-1),
+  epoll_fd_(-1),
+  signal_fd_(-1),
+  stopping_(false)
+{
+}
+
+Server::~Server()
+{
+    for (auto &pair : connections_) {
+        ::close(pair.first);
+    }
+
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+    }
+    if (signal_fd_ >= 0) {
+        ::close(signal_fd_);
+    }
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+    }
+}
+
+/**
+ * Start listening
+ * @param address TCP port on all interfaces, or path of a Unix socket
+ * @return True if successful, false otherwise
+ */
+bool Server::listen(const std::string &address)
+{
+    if (is_port(address)) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            return false;
+        }
+
+        int on = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<std::uint16_t>(std::atoi(address.c_str())));
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            return false;
+        }
+    } else {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        std::copy(address.begin(), address.end(), addr.sun_path);
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            return false;
+        }
+
+        // Replace a socket left behind by an earlier server
+        ::unlink(address.c_str());
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            return false;
+        }
+        unix_path_ = address;
+    }
+
+    if (::listen(listen_fd_, SOMAXCONN) != 0) {
+        return false;
+    }
+
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        return false;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) == 0;
+}
+
+/**
+ * Stop the event loop on SIGINT or SIGTERM instead of being killed
+ *
+ * The signals are blocked and read from a signalfd watched by epoll, so the
+ * loop returns normally and the destructor closes connections and removes
+ * a Unix socket. Call after listen() and before starting any threads.
+ * @return True if successful, false otherwise
+ */
+bool Server::stop_on_signals()
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if (::sigprocmask(SIG_BLOCK, &signals, nullptr) != 0) {
+        return false;
+    }
+
+    signal_fd_ = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd_ < 0) {
+        return false;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = signal_fd_;
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, signal_fd_, &event) == 0;
+}
+
+/**
+ * Serve connections until stopped
+ * @return True if stopped cleanly, false on an epoll error
+ */
+bool Server::run()
+{
+    epoll_event events[MAX_EVENTS];
+    while (!stopping_) {
+        int count = ::epoll_wait(epoll_fd_, events, MAX_EVENTS, 500);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                accept_all();
+                continue;
+            } else if (fd == signal_fd_) {
+                signalfd_siginfo info;
+                while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+                }
+                stop();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
+            }
+
+            auto &connection = *it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(connection);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                read_all(connection);
+            }
+            if (connections_.count(fd) && (events[i].events & EPOLLOUT)) {
+                flush(connection);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Ask the event loop to return
+ */
+void Server::stop()
+{
+    stopping_ = true;
+}
+
+/**
+ * Accept every pending connection
+ */
+void Server::accept_all()
+{
+    while (true) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        // Responses are small and latency matters more than packet count
+        if (unix_path_.empty()) {
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Connection> connection(new Connection);
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        connections_[fd] = std::move(connection);
+    }
+}
+
+/**
+ * Read what is available and answer every complete line
+ *
+ * Reading stops while the connection's unsent output is over MAX_OUTPUT, so
+ * a client that pipelines commands without reading the answers is held
+ * back by its own socket instead of growing the server's buffers.
+ * @param connection Connection to read from
+ */
+void Server::read_all(Connection &connection)
+{
+    char buffer[READ_SIZE];
+    while (!connection.eof && !connection.closing &&
+           connection.output.size() - connection.sent < MAX_OUTPUT) {
+        auto count = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (count > 0) {
+            connection.input.append(buffer, static_cast<std::size_t>(count));
+            if (!answer(connection)) {
+                return;
+            }
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // Peer closed; answer what it sent, then close once flushed
+        connection.eof = true;
+    }
+
+    flush(connection);
+}
+
+/**
+ * Answer buffered lines until the output backs up
+ * @param connection Connection to answer
+ * @return False if the connection was dropped, true otherwise
+ */
+bool Server::answer(Connection &connection)
+{
+    // The peer's last line counts even without a newline once it has closed
+    std::size_t start = 0;
+    while (!connection.closing && connection.output.size() - connection.sent < MAX_OUTPUT) {
+        auto end = connection.input.find('\n', start);
+        if (end == std::string::npos) {
+            if (!connection.eof || start == connection.input.size()) {
+                break;
+            }
+            end = connection.input.size();
+        }
+
+        auto line = connection.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        start = std::min(end + 1, connection.input.size());
+
+        handle(connection, line);
+    }
+    connection.input.erase(0, start);
+
+    if (connection.input.size() > MAX_LINE && connection.input.find('\n') == std::string::npos) {
+        close(connection);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Apply one command and queue its response
+ * @param connection Connection the command came from
+ * @param line Command line
+ * @return False if the client quit, true otherwise
+ */
+bool Server::handle(Connection &connection, const std::string &line)
+{
+    bool quit = false;
+    const bool join = line.compare(0, 6, "table ") == 0 && line.size() > 6;
+    capture_.str("");
+    if (join) {
+        connection.table = line.substr(6);
+        capture_ << "Joined table " << connection.table << "." << std::endl;
+    }
+
+    auto &session = tables_[connection.table];
+    if (!session) {
+        session.reset(new Session(nullptr));
+    }
+
+    // Exports write files synchronously into the server's directory, which
+    // would stall every other connection, so clients cannot ask for them
+    const bool playing = session->phase() == Session::Phase::Playing;
+    tokens::Token first;
+    if (!join && playing && tokens::split(line.data(), line.size(), &first, 1) > 0 &&
+        (first.front() == 'x' || first.front() == 'e')) {
+        capture_ << "Exports are not available over the server." << std::endl;
+    } else if (!join) {
+        // "d" also picks the default fans during setup, which ends in Playing
+        session->set_output(&capture_);
+        const auto outcome = session->feed(line);
+        session->set_output(nullptr);
+
+        if (outcome == Session::Outcome::Quit) {
+            quit = true;
+            connection.closing = true;
+            capture_ << "Bye." << std::endl;
+        } else if (outcome == Session::Outcome::Accepted && playing &&
+                   line.compare(0, 1, "d") == 0) {
+            // Deletions print no scores of their own
+            session->game()->set_output(&capture_);
+            session->game()->print_scores();
+            session->game()->set_output(nullptr);
+        }
+    }
+
+    // Clients cannot see a prompt, so send it until play starts
+    if (session->phase() != Session::Phase::Playing) {
+        capture_ << session->prompt() << '\n';
+    }
+
+    connection.output += capture_.str();
+    connection.output += END_OF_RESPONSE;
+    return !quit;
+}
+
+/**
+ * Send as much queued output as the socket takes, answering any lines held
+ * back while it was backed up
+ * @param connection Connection to send on
+ */
+void Server::flush(Connection &connection)
+{
+    while (true) {
+        while (connection.sent < connection.output.size()) {
+            auto count = ::send(connection.fd,
+                                connection.output.data() + connection.sent,
+                                connection.output.size() - connection.sent,
+                                MSG_NOSIGNAL);
+            if (count > 0) {
+                connection.sent += static_cast<std::size_t>(count);
+            } else if (count < 0 && errno == EINTR) {
+                continue;
+            } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                close(connection);
+                return;
+            }
+        }
+
+        if (connection.sent < connection.output.size()) {
+            break;
+        }
+
+        connection.output.clear();
+        connection.sent = 0;
+        if (!connection.closing && !answer(connection)) {
+            return;
+        }
+
+        if (connection.output.empty()) {
+            if (connection.closing || connection.eof) {
+                close(connection);
+                return;
+            }
+            break;
+        }
+    }
+
+    // Only wait for writability while output is backed up, and stop reading
+    // once the peer has sent EOF, or it keeps the socket readable forever
+    const bool pending = connection.sent < connection.output.size();
+    std::uint32_t events = 0;
+    if (!connection.closing && !connection.eof &&
+        connection.output.size() - connection.sent < MAX_OUTPUT) {
+        events |= EPOLLIN;
+    }
+    if (pending) {
+        events |= EPOLLOUT;
+    }
+
+    if (events != connection.events) {
+        connection.events = events;
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = connection.fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+/**
+ * Drop a connection
+ * @param connection Connection to drop; invalid afterwards
+ */
+void Server::close(Connection &connection)
+{
+    const int fd = connection.fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections_.erase(fd);
+}
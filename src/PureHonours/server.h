@@ -0,0 +1,64 @@
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include "session.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Single-threaded scoring server over TCP or a Unix socket
+ *
+ * Clients send lines in the session grammar and get back the session's
+ * output followed by a line holding a single ".". A connection starts at
+ * the "main" table and can move with "table <id>"; every connection at a
+ * table shares its session.
+ */
+class Server {
+public:
+    Server();
+    ~Server();
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    bool listen(const std::string &address);
+    bool stop_on_signals();
+    bool run();
+    void stop();
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        std::size_t sent = 0;
+        std::string table = "main";
+        bool eof = false;     // Peer has finished sending
+        bool closing = false; // Client quit; close once flushed
+        std::uint32_t events = 0; // Events registered with epoll
+    };
+
+    int listen_fd_;
+    int epoll_fd_;
+    int signal_fd_;
+    std::string unix_path_;
+    volatile bool stopping_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::map<std::string, std::unique_ptr<Session>> tables_;
+    std::ostringstream capture_;
+
+    void accept_all();
+    void read_all(Connection &connection);
+    bool answer(Connection &connection);
+    bool handle(Connection &connection, const std::string &line);
+    void flush(Connection &connection);
+    void close(Connection &connection);
+};
+
+#endif // __SERVER_H
@@ -0,0 +1,448 @@
+#include "session.h"
+#include "exporter.h"
+#include "metrics.h"
+
+#include <iostream>
+#include <istream>
+#include <ostream>
+
+namespace
+{
+
+// Rounds per page for "p page <n>"
+const std::size_t PAGE_SIZE = 20;
+
+/**
+ * Stream that discards everything written to it
+ * @return Null stream
+ */
+std::ostream &discard()
+{
+    static std::ostream null_stream(nullptr);
+    return null_stream;
+}
+
+} // namespace
+
+/**
+ * Constructor for session
+ * @param out Stream for messages, or nullptr to run quietly
+ */
+Session::Session(std::ostream *out)
+: out_(out),
+  phase_(Phase::PlayerCount),
+  players_(0),
+  exporter_(nullptr)
+{
+}
+
+/**
+ * Process one line of input
+ * @param line Raw input line
+ * @return Outcome of the line
+ */
+Session::Outcome Session::feed(const std::string &line)
+{
+    METRICS_TIME(Command);
+    tokens::Token tokens[tokens::MAX_TOKENS];
+    const auto count = tokens::split(line.data(), line.size(), tokens, tokens::MAX_TOKENS);
+    if (phase_ == Phase::Playing) {
+        return feed_command(tokens, count);
+    }
+
+    return feed_setup(tokens, count);
+}
+
+/**
+ * Feed every line of a stream without output
+ * @param in Stream of recorded commands
+ * @return Number of lines read
+ */
+std::size_t Session::replay(std::istream &in)
+{
+    auto out = out_;
+    set_output(nullptr);
+
+    std::size_t count = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        // A final line without a newline is a torn write; skip it
+        if (in.eof()) {
+            break;
+        }
+
+        ++count;
+        if (feed(line) == Outcome::Quit) {
+            break;
+        }
+    }
+
+    set_output(out);
+    return count;
+}
+
+/**
+ * Resume play with an already-built game
+ * @param game Game to take over
+ */
+void Session::restore(std::unique_ptr<PureHonours> &&game)
+{
+    game_ = std::move(game);
+    game_->set_output(out_);
+    players_ = game_->player_count();
+    player_names_ = game_->player_names();
+    player_ids_.assign(player_names_);
+    delta_csv_ = DeltaCsv();
+    phase_ = Phase::Playing;
+}
+
+/**
+ * Redirect session and game output
+ * @param out Stream to write to, or nullptr to run quietly
+ */
+void Session::set_output(std::ostream *out)
+{
+    out_ = out;
+    if (game_) {
+        game_->set_output(out);
+    }
+}
+
+/**
+ * Hand exports to a background exporter instead of writing them in place
+ * @param exporter Exporter to use, or nullptr to write exports before returning
+ */
+void Session::set_exporter(Exporter *exporter)
+{
+    exporter_ = exporter;
+}
+
+/**
+ * Get current phase
+ * @return Current phase
+ */
+Session::Phase Session::phase() const
+{
+    return phase_;
+}
+
+/**
+ * Get prompt for the next line
+ * @return Prompt text
+ */
+const std::string Session::prompt() const
+{
+    switch (phase_) {
+    case Phase::PlayerCount:
+        return "How many players? ";
+    case Phase::PlayerNames:
+        return "Initials for player " + std::to_string(player_names_.size() + 1) + ": ";
+    case Phase::Fans:
+        return "Add fan/score (Enter to finish, \"d\" for default): ";
+    case Phase::Playing:
+        break;
+    }
+
+    return "\nInput command (? for help): ";
+}
+
+/**
+ * Get game once players are set up
+ * @return Game, or nullptr if still setting up players
+ */
+PureHonours *Session::game()
+{
+    return game_.get();
+}
+
+const PureHonours *Session::game() const
+{
+    return game_.get();
+}
+
+/**
+ * Process a setup line
+ * @param tokens Tokens of the line
+ * @param count Number of tokens
+ * @return Outcome of the line
+ */
+Session::Outcome Session::feed_setup(const tokens::Token *tokens, std::size_t count)
+{
+    std::ostream &out = out_ ? *out_ : discard();
+    const tokens::Token command = count > 0 ? tokens[0] : tokens::Token();
+
+    if (phase_ == Phase::PlayerCount) {
+        int players = 0;
+        if (!tokens::to_int(command, players) || players < 2 || players > 4) {
+            out << "Invalid player count." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        players_ = players;
+        phase_ = Phase::PlayerNames;
+        return Outcome::Accepted;
+    } else if (phase_ == Phase::PlayerNames) {
+        // Prevent "self" and "selfg" from being a name (used in command)
+        if (command == "self" || command == "selfg") {
+            out << "Players cannot be named \"self\"." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        player_names_.push_back(command.str());
+        if (player_names_.size() == static_cast<std::size_t>(players_)) {
+            // Initialize game
+            player_ids_.assign(player_names_);
+            auto names = player_names_;
+            game_.reset(new PureHonours(players_, std::move(names)));
+            game_->set_output(out_);
+            phase_ = Phase::Fans;
+            out << std::endl;
+        }
+        return Outcome::Accepted;
+    }
+
+    // Fans
+    int fan = 0;
+    int score = 0;
+    if (command.front() == 'd') {
+        game_->default_fans();
+        phase_ = Phase::Playing;
+        return Outcome::Accepted;
+    } else if (count == 0 && !game_->fan_scores().empty()) {
+        // Enter finishes a table of custom fans
+        phase_ = Phase::Playing;
+        return Outcome::Accepted;
+    } else if (count < 2 || !tokens::to_int(command, fan) || !tokens::to_int(tokens[1], score)) {
+        out << "Invalid input." << std::endl;
+        return Outcome::Rejected;
+    } else if (fan < 0 || fan > MAX_FAN) {
+        out << "Invalid fan value." << std::endl;
+        return Outcome::Rejected;
+    }
+
+    game_->add_fan_score(fan, score);
+    return Outcome::Accepted;
+}
+
+/**
+ * Process a game command
+ * @param tokens Tokens of the line
+ * @param count Number of tokens
+ * @return Outcome of the command
+ */
+Session::Outcome Session::feed_command(const tokens::Token *tokens, std::size_t count)
+{
+    std::ostream &out = out_ ? *out_ : discard();
+    const char command = count > 0 ? tokens[0].front() : '\0';
+    const std::size_t arg_count = count > 0 ? count - 1 : 0;
+
+    if (command == 'q') {
+        // Quit
+        return Outcome::Quit;
+    } else if (command == '?') {
+        // Help
+        out << "Commands:\n"
+            << "  ?\n"
+            << "    Display help\n"
+            << "  q\n"
+            << "    Quit\n"
+            << "  a <winner> <fan> self\n"
+            << "    Add self-touch win by <winner>\n"
+            << "  a <winner> <fan> selfg <loser>\n"
+            << "    Add self-touch off gong win by <winner>\n"
+            << "  a <winner> <fan> <loser>\n"
+            << "    Add a win by <winner>, fed by <loser>\n"
+            << "  d\n"
+            << "    Delete the last-entered score\n"
+            << "  d <round_number>\n"
+            << "    Delete the score of a specific round\n"
+            << "  u\n"
+            << "    Undo the last add or delete\n"
+            << "  r\n"
+            << "    Redo the last undone change\n"
+            << "  s\n"
+            << "    Print short score report\n"
+            << "  t\n"
+            << "    Print player statistics\n"
+            << "  p\n"
+            << "    Print full score report\n"
+            << "  p <count>\n"
+            << "    Print score report for the last <count> rounds\n"
+            << "  p <first> <last>\n"
+            << "    Print score report for rounds <first> to <last>\n"
+            << "  p page <page>\n"
+            << "    Print score report a page of " << PAGE_SIZE << " rounds at a time\n"
+            << "  h\n"
+            << "    Print standings with each player's peak, trough and largest drawdown\n"
+            << "  h <round>\n"
+            << "    Print standings as they were after round <round>\n"
+            << "  h <first> <last>\n"
+            << "    Print standings over rounds <first> to <last>\n"
+            << "  x\n"
+            << "    Export results to CSV file\n"
+            << "  x delta\n"
+            << "    Update this session's CSV file, rewriting only rounds that changed\n"
+            << "  e\n"
+            << "    Export results to binary session file\n"
+            << "  m\n"
+            << "    Print performance metrics\n";
+        return Outcome::Viewed;
+    } else if (command == 'a' && arg_count >= 3) {
+        // Add; check winner
+        std::size_t winner_index = player_ids_.find(tokens[1]);
+        if (winner_index == static_cast<std::size_t>(players_)) {
+            out << "Invalid winner initials." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        int fan = 0;
+        if (!tokens::to_int(tokens[2], fan) || fan > MAX_FAN) {
+            out << "Invalid fan value." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        // If self-draw, just add it
+        if (tokens[3] == "self") {
+            game_->add_result(winner_index, fan, true);
+            return Outcome::Accepted;
+        }
+
+        // Check for direct gong
+        auto loser = tokens[3];
+        bool is_gong_self = false;
+        if (loser == "selfg" && arg_count >= 4) {
+            is_gong_self = true;
+            loser = tokens[4];
+        } else if (loser == "selfg") {
+            out << "Invalid loser initials for direct hit gong win." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        std::size_t loser_index = player_ids_.find(loser);
+        if (loser_index == static_cast<std::size_t>(players_)) {
+            out << "Invalid loser initials." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        // Add score
+        game_->add_result(winner_index, fan, is_gong_self, loser_index, is_gong_self);
+        return Outcome::Accepted;
+    } else if (command == 'd') {
+        // Check for index
+        if (arg_count > 0) {
+            std::size_t index = 0;
+            if (!tokens::to_size(tokens[1], index) || !game_->delete_score(index)) {
+                out << "Invalid round number." << std::endl;
+                return Outcome::Rejected;
+            }
+
+            out << "Deleted round " << index << "." << std::endl;
+            return Outcome::Accepted;
+        }
+
+        if (!game_->delete_score()) {
+            out << "No entries to delete." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        out << "Deleted last round." << std::endl;
+        return Outcome::Accepted;
+    } else if (command == 'u') {
+        if (!game_->undo()) {
+            out << "Nothing to undo." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        return Outcome::Accepted;
+    } else if (command == 'r') {
+        if (!game_->redo()) {
+            out << "Nothing to redo." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        return Outcome::Accepted;
+    } else if (command == 's') {
+        game_->print_scores();
+        return Outcome::Viewed;
+    } else if (command == 't') {
+        game_->print_statistics();
+        return Outcome::Viewed;
+    } else if (command == 'p') {
+        if (arg_count == 0) {
+            game_->print_report();
+            return Outcome::Viewed;
+        }
+
+        const std::size_t rounds = game_->round_count();
+        std::size_t first = 0;
+        std::size_t last = 0;
+        std::size_t number = 0;
+        bool valid = false;
+        if (tokens[1] == "page" && arg_count >= 2) {
+            valid = tokens::to_size(tokens[2], number);
+            first = (number > 0 ? number - 1 : 0) * PAGE_SIZE + 1;
+            last = first + PAGE_SIZE - 1;
+        } else if (arg_count >= 2) {
+            valid = tokens::to_size(tokens[1], first) && tokens::to_size(tokens[2], last);
+        } else {
+            valid = tokens::to_size(tokens[1], number);
+            first = rounds > number ? rounds - number + 1 : 1;
+            last = rounds;
+        }
+
+        if (!valid) {
+            out << "Invalid round range." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        game_->print_report(first, last);
+        return Outcome::Viewed;
+    } else if (command == 'h') {
+        const std::size_t rounds = game_->round_count();
+        std::size_t first = 1;
+        std::size_t last = rounds;
+        bool valid = true;
+        if (arg_count >= 2) {
+            valid = tokens::to_size(tokens[1], first) && tokens::to_size(tokens[2], last);
+        } else if (arg_count == 1) {
+            valid = tokens::to_size(tokens[1], last);
+        }
+
+        if (!valid || first == 0 || first > last || last > rounds) {
+            out << "Invalid round range." << std::endl;
+            return Outcome::Rejected;
+        }
+
+        game_->print_standings(first, last);
+        return Outcome::Viewed;
+    } else if (command == 'x' && arg_count > 0 && tokens[1] == "delta") {
+        if (!delta_csv_.write(*game_)) {
+            std::cerr << "Failed to write file: " << delta_csv_.filename() << std::endl;
+            return Outcome::Viewed;
+        }
+
+        out << "Saved to: " << delta_csv_.filename() << " (" << delta_csv_.rows_written()
+            << " rounds written)" << std::endl;
+        return Outcome::Viewed;
+    } else if (command == 'x' || command == 'e') {
+        if (!exporter_ && command == 'x') {
+            game_->print_csv();
+            return Outcome::Viewed;
+        } else if (!exporter_) {
+            game_->export_file();
+            return Outcome::Viewed;
+        }
+
+        // Written in the background from a copy; finishing is reported later
+        const auto format = command == 'x' ? Exporter::Format::Csv : Exporter::Format::Session;
+        out << "Exporting to: " << exporter_->submit(*game_, format) << std::endl;
+        return Outcome::Viewed;
+    } else if (command == 'm') {
+        metrics::print(out);
+        return Outcome::Viewed;
+    }
+
+    // Invalid
+    out << "Invalid command. Type ? for help." << std::endl;
+    return Outcome::Rejected;
+}
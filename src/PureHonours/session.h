@@ -0,0 +1,66 @@
+#ifndef __SESSION_H
+#define __SESSION_H
+
+#include "delta_csv.h"
+#include "player_ids.h"
+#include "purehonours.h"
+#include "tokens.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Exporter;
+
+/**
+ * Line-driven game session
+ *
+ * Walks through player setup, fan setup and play one input line at a time,
+ * so the REPL, history replay and any other line source share one grammar.
+ */
+class Session {
+public:
+    enum class Phase {
+        PlayerCount,
+        PlayerNames,
+        Fans,
+        Playing,
+    };
+
+    enum class Outcome {
+        Rejected, // Invalid input, nothing changed
+        Accepted, // State changed; should be recorded in history
+        Viewed,   // Valid read-only command
+        Quit,
+    };
+
+    explicit Session(std::ostream *out);
+
+    Outcome feed(const std::string &line);
+    std::size_t replay(std::istream &in);
+    void restore(std::unique_ptr<PureHonours> &&game);
+    void set_output(std::ostream *out);
+    void set_exporter(Exporter *exporter);
+
+    Phase phase() const;
+    const std::string prompt() const;
+    PureHonours *game();
+    const PureHonours *game() const;
+
+private:
+    std::ostream *out_;
+    Phase phase_;
+    int players_;
+    std::vector<std::string> player_names_;
+    PlayerIds player_ids_;
+    std::unique_ptr<PureHonours> game_;
+    Exporter *exporter_;
+    DeltaCsv delta_csv_;
+
+    Outcome feed_setup(const tokens::Token *tokens, std::size_t count);
+    Outcome feed_command(const tokens::Token *tokens, std::size_t count);
+};
+
+#endif // __SESSION_H
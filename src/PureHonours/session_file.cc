@@ -0,0 +1,364 @@
+#include "session_file.h"
+#include "session.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+const char MAGIC[4] = {'P', 'H', 'S', 'F'};
+
+} // namespace
+
+namespace session_file
+{
+
+Reader::Reader()
+: data_(nullptr),
+  length_(0),
+  undo_size_(0),
+  redo_size_(0)
+{
+}
+
+Reader::~Reader()
+{
+    close();
+}
+
+/**
+ * Map a session file and validate its header
+ * @param filename Path of the session file
+ * @return True if successful, false otherwise
+ */
+bool Reader::open(const std::string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        return false;
+    }
+
+    length_ = static_cast<std::size_t>(st.st_size);
+    data_ = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        length_ = 0;
+        return false;
+    }
+
+    const auto &h = header();
+    if (!std::equal(h.magic, h.magic + sizeof(MAGIC), MAGIC) ||
+        h.version < 1 || h.version > VERSION ||
+        h.header_size != sizeof(Header) ||
+        h.record_size != sizeof(Record) ||
+        h.player_count < 2 || h.player_count > MAX_PLAYERS ||
+        h.fan_count > MAX_FANS ||
+        h.record_count > (length_ - sizeof(Header)) / sizeof(Record)) {
+        close();
+        return false;
+    }
+
+    // Version 1 files have no edit history
+    if (h.version >= 2) {
+        const auto counts_offset = sizeof(Header) + size() * sizeof(Record);
+        if (length_ - counts_offset < sizeof(EditCounts)) {
+            close();
+            return false;
+        }
+
+        EditCounts counts;
+        std::memcpy(&counts, static_cast<const char *>(data_) + counts_offset, sizeof(counts));
+        const auto room = (length_ - counts_offset - sizeof(EditCounts)) / sizeof(EditRecord);
+        if (counts.undo_count > room || counts.redo_count > room - counts.undo_count) {
+            close();
+            return false;
+        }
+
+        undo_size_ = static_cast<std::size_t>(counts.undo_count);
+        redo_size_ = static_cast<std::size_t>(counts.redo_count);
+    }
+
+    ::madvise(data_, length_, MADV_SEQUENTIAL);
+    return true;
+}
+
+/**
+ * Unmap the file
+ */
+void Reader::close()
+{
+    if (data_) {
+        ::munmap(data_, length_);
+        data_ = nullptr;
+        length_ = 0;
+    }
+
+    undo_size_ = 0;
+    redo_size_ = 0;
+}
+
+/**
+ * Get file header
+ * @return Header of the mapped file
+ */
+const Header &Reader::header() const
+{
+    return *static_cast<const Header *>(data_);
+}
+
+/**
+ * Get first record
+ * @return Pointer to the first record
+ */
+const Record *Reader::begin() const
+{
+    return reinterpret_cast<const Record *>(static_cast<const char *>(data_) + sizeof(Header));
+}
+
+/**
+ * Get end of records
+ * @return Pointer past the last record
+ */
+const Record *Reader::end() const
+{
+    return begin() + size();
+}
+
+/**
+ * Get number of records
+ * @return Number of records
+ */
+std::size_t Reader::size() const
+{
+    return data_ ? static_cast<std::size_t>(header().record_count) : 0;
+}
+
+/**
+ * Get first undo entry
+ * @return Pointer to the oldest undo entry
+ */
+const EditRecord *Reader::undo() const
+{
+    return reinterpret_cast<const EditRecord *>(reinterpret_cast<const char *>(end()) + sizeof(EditCounts));
+}
+
+/**
+ * Get number of undo entries
+ * @return Number of undo entries
+ */
+std::size_t Reader::undo_size() const
+{
+    return undo_size_;
+}
+
+/**
+ * Get first redo entry
+ * @return Pointer to the oldest redo entry
+ */
+const EditRecord *Reader::redo() const
+{
+    return undo() + undo_size_;
+}
+
+/**
+ * Get number of redo entries
+ * @return Number of redo entries
+ */
+std::size_t Reader::redo_size() const
+{
+    return redo_size_;
+}
+
+/**
+ * Write a game as a session file
+ * @param filename Path to write to
+ * @param game Game to write
+ * @param history_offset Bytes of history covered, for snapshots
+ * @return True if successful, false otherwise
+ */
+bool write(const std::string &filename,
+           const PureHonours &game,
+           long long history_offset)
+{
+    const auto &names = game.player_names();
+    const auto &fans = game.fan_scores();
+    if (names.size() > MAX_PLAYERS || fans.size() > MAX_FANS) {
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.record_size = sizeof(Record);
+    header.player_count = static_cast<std::uint8_t>(names.size());
+    header.fan_count = static_cast<std::uint8_t>(fans.size());
+    header.record_count = game.rounds().size();
+    header.history_offset = history_offset;
+
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        // Leave room for the terminator
+        if (names[i].size() >= NAME_LENGTH) {
+            return false;
+        }
+        std::copy(names[i].begin(), names[i].end(), header.player_names[i]);
+    }
+
+    std::size_t count = 0;
+    for (auto &pair : fans) {
+        header.fans[count].fan = pair.first;
+        header.fans[count].score = pair.second;
+        ++count;
+    }
+
+    std::vector<Record> records;
+    records.reserve(game.rounds().size());
+    for (auto &round : game.rounds()) {
+        Record record;
+        record.winning_player = round.winning_player;
+        record.losing_player = round.losing_player;
+        record.flags = (round.self_draw() ? SELF_DRAW : 0) |
+                       (round.gong_direct() ? GONG_DIRECT : 0) |
+                       (round.deleted() ? DELETED : 0);
+        record.reserved = 0;
+        record.fan = round.fan;
+        records.push_back(record);
+    }
+
+    EditCounts counts;
+    counts.undo_count = game.undo_history().size();
+    counts.redo_count = game.redo_history().size();
+
+    std::vector<EditRecord> edits;
+    edits.reserve(counts.undo_count + counts.redo_count);
+    for (auto stack : {&game.undo_history(), &game.redo_history()}) {
+        for (auto &edit : *stack) {
+            EditRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.position = edit.position();
+            record.kind = edit.kind() == Edit::Kind::Add ? EDIT_ADD : EDIT_DELETE;
+            edits.push_back(record);
+        }
+    }
+
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.data()),
+               static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    file.write(reinterpret_cast<const char *>(&counts), sizeof(counts));
+    file.write(reinterpret_cast<const char *>(edits.data()),
+               static_cast<std::streamsize>(edits.size() * sizeof(EditRecord)));
+    file.close();
+
+    return !file.fail();
+}
+
+/**
+ * Rebuild a game from a mapped session file
+ * @param reader Open reader
+ * @return Game, or nullptr if the records are invalid
+ */
+std::unique_ptr<PureHonours> load(const Reader &reader)
+{
+    const auto &header = reader.header();
+
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < header.player_count; ++i) {
+        const char *name = header.player_names[i];
+        names.emplace_back(name, std::find(name, name + NAME_LENGTH, '\0'));
+    }
+
+    std::unique_ptr<PureHonours> game(new PureHonours(header.player_count, std::move(names)));
+    game->set_output(nullptr);
+    for (std::size_t i = 0; i < header.fan_count; ++i) {
+        if (header.fans[i].fan < 0 || header.fans[i].fan > MAX_FAN) {
+            return nullptr;
+        }
+        game->add_fan_score(header.fans[i].fan, header.fans[i].score);
+    }
+
+    std::vector<Round> rounds;
+    rounds.reserve(reader.size());
+    for (auto record = reader.begin(); record != reader.end(); ++record) {
+        if (record->winning_player >= header.player_count ||
+            record->losing_player >= header.player_count ||
+            record->fan < 0 || record->fan > MAX_FAN) {
+            return nullptr;
+        }
+
+        Round round;
+        round.winning_player = record->winning_player;
+        round.losing_player = record->losing_player;
+        round.fan = static_cast<std::uint8_t>(record->fan);
+        round.flags = record->flags & (SELF_DRAW | GONG_DIRECT | DELETED);
+        rounds.push_back(round);
+    }
+
+    std::vector<Edit> undo;
+    std::vector<Edit> redo;
+    auto read_edits = [](const EditRecord *first, std::size_t count, std::vector<Edit> &edits) {
+        for (auto record = first; record != first + count; ++record) {
+            if (record->position > Edit::MAX_POSITION) {
+                return false;
+            }
+
+            const auto kind = record->kind == EDIT_ADD ? Edit::Kind::Add : Edit::Kind::Delete;
+            edits.push_back(Edit(kind, static_cast<std::size_t>(record->position)));
+        }
+        return true;
+    };
+
+    if (!read_edits(reader.undo(), reader.undo_size(), undo) ||
+        !read_edits(reader.redo(), reader.redo_size(), redo) ||
+        !game->restore(std::move(rounds), std::move(undo), std::move(redo))) {
+        return nullptr;
+    }
+
+    return game;
+}
+
+/**
+ * Convert a history file into a session file
+ * @param history_filename Path of the history file
+ * @param output_filename Path to write to
+ * @return True if successful, false otherwise
+ */
+bool convert(const std::string &history_filename,
+             const std::string &output_filename)
+{
+    std::ifstream history(history_filename);
+    if (!history.is_open()) {
+        return false;
+    }
+
+    Session session(nullptr);
+    session.replay(history);
+    if (!session.game()) {
+        return false;
+    }
+
+    return write(output_filename, *session.game());
+}
+
+} // namespace session_file
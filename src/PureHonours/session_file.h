@@ -0,0 +1,121 @@
+#ifndef __SESSION_FILE_H
+#define __SESSION_FILE_H
+
+#include "purehonours.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Versioned binary session format
+//
+// A fixed-size header holding the players and fan table is followed by
+// fixed-size records, one per result, so a mapped file can be walked
+// directly. Version 2 keeps deleted results as flagged records and follows
+// them with the undo and redo history. Fields are stored in host byte order.
+namespace session_file
+{
+
+const std::uint16_t VERSION = 2;
+const std::size_t MAX_PLAYERS = 4;
+const std::size_t NAME_LENGTH = 16;
+const std::size_t MAX_FANS = 32;
+
+// Record flags
+const std::uint8_t SELF_DRAW = 1;
+const std::uint8_t GONG_DIRECT = 2;
+const std::uint8_t DELETED = 4;
+
+// Edit kinds
+const std::uint8_t EDIT_ADD = 0;
+const std::uint8_t EDIT_DELETE = 1;
+
+struct FanScore {
+    std::int32_t fan;
+    std::int32_t score;
+};
+
+struct Header {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t header_size;
+    std::uint32_t record_size;
+    std::uint8_t player_count;
+    std::uint8_t fan_count;
+    std::uint16_t reserved;
+    std::uint64_t record_count;
+    std::int64_t history_offset;
+    char player_names[MAX_PLAYERS][NAME_LENGTH];
+    FanScore fans[MAX_FANS];
+};
+
+struct Record {
+    std::uint8_t winning_player;
+    std::uint8_t losing_player;
+    std::uint8_t flags;
+    std::uint8_t reserved;
+    std::int32_t fan;
+};
+
+// Follows the records (version 2 and later)
+struct EditCounts {
+    std::uint64_t undo_count;
+    std::uint64_t redo_count;
+};
+
+// Undo entries, then redo entries, each oldest first
+struct EditRecord {
+    std::uint64_t position;
+    std::uint8_t kind;
+    std::uint8_t reserved[7];
+};
+
+static_assert(sizeof(Header) == 352, "Header layout changed");
+static_assert(sizeof(Record) == 8, "Record layout changed");
+static_assert(sizeof(EditCounts) == 16, "EditCounts layout changed");
+static_assert(sizeof(EditRecord) == 16, "EditRecord layout changed");
+
+/**
+ * Read-only memory-mapped view of a session file
+ */
+class Reader {
+public:
+    Reader();
+    ~Reader();
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    bool open(const std::string &filename);
+    void close();
+
+    const Header &header() const;
+    const Record *begin() const;
+    const Record *end() const;
+    std::size_t size() const;
+
+    const EditRecord *undo() const;
+    std::size_t undo_size() const;
+    const EditRecord *redo() const;
+    std::size_t redo_size() const;
+
+private:
+    void *data_;
+    std::size_t length_;
+    std::size_t undo_size_;
+    std::size_t redo_size_;
+};
+
+bool write(const std::string &filename,
+           const PureHonours &game,
+           long long history_offset = 0);
+
+std::unique_ptr<PureHonours> load(const Reader &reader);
+
+bool convert(const std::string &history_filename,
+             const std::string &output_filename);
+
+} // namespace session_file
+
+#endif // __SESSION_FILE_H
@@ -0,0 +1,311 @@
+#include "simulate.h"
+#include "purehonours.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <ostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Fan frequencies used when none are given
+const std::pair<int, int> DEFAULT_WEIGHTS[] = {
+    {3, 30}, {4, 24}, {5, 16}, {6, 11}, {7, 7}, {8, 5},
+    {9, 3}, {10, 2}, {11, 1}, {12, 1}, {13, 1},
+};
+
+// Names used for simulated players
+const char *const NAMES[] = {"A", "B", "C", "D"};
+
+// One thread's share of the results
+struct Partial {
+    std::vector<int> finals;
+    std::size_t hands = 0;
+    std::size_t rejected = 0;
+    std::size_t busts = 0;
+    std::size_t sessions_bust = 0;
+    double hand_sum = 0;
+    double hand_squares = 0;
+};
+
+/**
+ * Play a range of sessions
+ * @param config Simulation settings
+ * @param prototype Empty game holding the fan table
+ * @param first First session index
+ * @param last One past the last session index
+ * @param stream RNG stream for this thread
+ * @return Results for the range
+ */
+Partial play(const simulate::Config &config,
+             const PureHonours &prototype,
+             std::size_t first,
+             std::size_t last,
+             std::uint64_t stream)
+{
+    Partial partial;
+    std::seed_seq seed{static_cast<std::uint32_t>(config.seed),
+                       static_cast<std::uint32_t>(config.seed >> 32),
+                       static_cast<std::uint32_t>(stream)};
+    std::mt19937_64 rng(seed);
+
+    std::vector<int> fans;
+    std::vector<int> weights;
+    for (auto &pair : config.fan_weights) {
+        fans.push_back(pair.first);
+        weights.push_back(pair.second);
+    }
+
+    const int players = config.players;
+    std::discrete_distribution<std::size_t> fan(weights.begin(), weights.end());
+    std::uniform_real_distribution<double> kind(0.0, 1.0);
+    std::uniform_int_distribution<int> seat(0, players - 1);
+    std::uniform_int_distribution<int> other(1, players - 1);
+
+    partial.finals.reserve((last - first) * static_cast<std::size_t>(players));
+    for (std::size_t s = first; s < last; ++s) {
+        auto game = prototype;
+        bool busted[MAX_PLAYERS] = {};
+        bool any_bust = false;
+
+        for (std::size_t r = 0; r < config.rounds; ++r) {
+            const auto winner = static_cast<std::size_t>(seat(rng));
+            const auto loser = (winner + static_cast<std::size_t>(other(rng))) % static_cast<std::size_t>(players);
+            const double k = kind(rng);
+            const bool gong_direct = k < config.gong_direct;
+            const bool self_draw = gong_direct || k < config.gong_direct + config.self_draw;
+
+            const auto before = game.totals()[winner];
+            const auto count = game.round_count();
+            game.add_result(winner, fans[fan(rng)], self_draw, loser, gong_direct);
+            if (game.round_count() == count) {
+                ++partial.rejected;
+                continue;
+            }
+
+            const double won = game.totals()[winner] - before;
+            ++partial.hands;
+            partial.hand_sum += won;
+            partial.hand_squares += won * won;
+
+            for (int p = 0; p < players; ++p) {
+                if (!busted[p] && game.totals()[p] <= -config.bust) {
+                    busted[p] = true;
+                    any_bust = true;
+                    ++partial.busts;
+                }
+            }
+        }
+
+        partial.finals.insert(partial.finals.end(), game.totals().begin(), game.totals().end());
+        if (any_bust) {
+            ++partial.sessions_bust;
+        }
+    }
+
+    return partial;
+}
+
+/**
+ * Find a percentile of sorted values
+ * @param sorted Values in ascending order
+ * @param percent Percentile to find
+ * @return Value at that percentile
+ */
+int percentile(const std::vector<int> &sorted, double percent)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    auto index = static_cast<std::size_t>(percent / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+namespace simulate
+{
+
+/**
+ * Parse "<fan>:<value>,..." pairs
+ * @param spec Comma-separated pairs, each fan from 0 to MAX_FAN
+ * @param pairs Filled with the parsed pairs
+ * @return True if successful, false otherwise
+ */
+bool parse_pairs(const std::string &spec, std::map<int, int> &pairs)
+{
+    pairs.clear();
+    std::size_t start = 0;
+    while (start < spec.size()) {
+        auto end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+
+        const auto item = spec.substr(start, end - start);
+        const auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+
+        try {
+            const int fan = std::stoi(item.substr(0, colon));
+            if (fan < 0 || fan > MAX_FAN) {
+                return false;
+            }
+            pairs[fan] = std::stoi(item.substr(colon + 1));
+        } catch (std::exception &) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return !pairs.empty();
+}
+
+/**
+ * Get the fan frequencies used when none are given
+ * @return Relative frequency of each fan
+ */
+std::map<int, int> default_fan_weights()
+{
+    return std::map<int, int>(std::begin(DEFAULT_WEIGHTS), std::end(DEFAULT_WEIGHTS));
+}
+
+/**
+ * Play random sessions in parallel and summarise the scores
+ * @param config Simulation settings
+ * @return Distribution of the results
+ */
+Result run(const Config &config)
+{
+    Config settings = config;
+    if (settings.fan_weights.empty()) {
+        settings.fan_weights = default_fan_weights();
+    }
+
+    PureHonours prototype(settings.players,
+                          std::vector<std::string>(NAMES, NAMES + settings.players));
+    prototype.set_output(nullptr);
+    if (settings.fan_table.empty()) {
+        prototype.default_fans();
+    } else {
+        for (auto &pair : settings.fan_table) {
+            prototype.add_fan_score(pair.first, pair.second);
+        }
+    }
+
+    std::size_t threads = settings.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<std::size_t>(1, std::min(threads, settings.sessions));
+
+    // Each thread plays a contiguous share of sessions on its own RNG stream,
+    // counting locally so threads only touch shared memory once at the end
+    std::vector<Partial> partials(threads);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        const auto first = settings.sessions * t / threads;
+        const auto last = settings.sessions * (t + 1) / threads;
+        workers.emplace_back([&settings, &prototype, &partials, first, last, t]() {
+            partials[t] = play(settings, prototype, first, last, t);
+        });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    Result result;
+    result.sessions = settings.sessions;
+
+    std::vector<int> finals;
+    std::size_t busts = 0;
+    std::size_t sessions_bust = 0;
+    double hand_sum = 0;
+    double hand_squares = 0;
+    for (auto &partial : partials) {
+        finals.insert(finals.end(), partial.finals.begin(), partial.finals.end());
+        result.hands += partial.hands;
+        result.rejected += partial.rejected;
+        busts += partial.busts;
+        sessions_bust += partial.sessions_bust;
+        hand_sum += partial.hand_sum;
+        hand_squares += partial.hand_squares;
+    }
+
+    if (finals.empty()) {
+        return result;
+    }
+
+    double sum = 0;
+    double squares = 0;
+    for (auto score : finals) {
+        sum += score;
+        squares += static_cast<double>(score) * score;
+    }
+
+    const double n = static_cast<double>(finals.size());
+    result.mean = sum / n;
+    result.stddev = std::sqrt(std::max(0.0, squares / n - result.mean * result.mean));
+
+    std::sort(finals.begin(), finals.end());
+    result.min = finals.front();
+    result.max = finals.back();
+    result.p1 = percentile(finals, 1);
+    result.p5 = percentile(finals, 5);
+    result.p25 = percentile(finals, 25);
+    result.p50 = percentile(finals, 50);
+    result.p75 = percentile(finals, 75);
+    result.p95 = percentile(finals, 95);
+    result.p99 = percentile(finals, 99);
+
+    if (result.hands > 0) {
+        const double hands = static_cast<double>(result.hands);
+        result.hand_mean = hand_sum / hands;
+        result.hand_stddev = std::sqrt(std::max(0.0, hand_squares / hands - result.hand_mean * result.hand_mean));
+    }
+
+    result.bust_rate = busts / n;
+    result.session_bust_rate = static_cast<double>(sessions_bust) / result.sessions;
+    return result;
+}
+
+/**
+ * Print a simulation summary
+ * @param config Simulation settings
+ * @param result Simulation results
+ * @param out Stream to print to
+ */
+void print(const Config &config, const Result &result, std::ostream &out)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+
+    out << std::fixed << std::setprecision(2);
+    out << result.sessions << " sessions of " << config.rounds << " hands, "
+        << config.players << " players (" << result.hands << " scored, "
+        << result.rejected << " below minimum fan)" << '\n';
+    out << "Final score:  mean " << result.mean << ", stddev " << result.stddev
+        << ", min " << result.min << ", max " << result.max << '\n';
+    out << "Percentiles:  p1 " << result.p1 << ", p5 " << result.p5
+        << ", p25 " << result.p25 << ", p50 " << result.p50
+        << ", p75 " << result.p75 << ", p95 " << result.p95
+        << ", p99 " << result.p99 << '\n';
+    out << "Hand winner:  mean " << result.hand_mean << ", stddev " << result.hand_stddev << '\n';
+    out << "Bust at -" << config.bust << ": " << result.bust_rate * 100 << "% of players, "
+        << result.session_bust_rate * 100 << "% of sessions" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace simulate
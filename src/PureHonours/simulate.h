@@ -0,0 +1,63 @@
+#ifndef __SIMULATE_H
+#define __SIMULATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+// Monte Carlo sessions for comparing fan/score tables
+namespace simulate
+{
+
+struct Config {
+    int players = 4;
+    std::size_t sessions = 0;
+    std::size_t rounds = 16;       // Hands per session
+    double self_draw = 0.25;       // Share of hands won by plain self-draw
+    double gong_direct = 0.05;     // Share of hands won by self-draw off a gong
+    std::map<int, int> fan_weights; // Relative frequency of each fan, empty for defaults
+    std::map<int, int> fan_table;   // Fan/score table under test, empty for defaults
+    long long bust = 1000;         // A player busts once this far behind
+    std::uint64_t seed = 1;
+    std::size_t threads = 0;
+};
+
+struct Result {
+    std::size_t sessions = 0;
+    std::size_t hands = 0;
+    std::size_t rejected = 0; // Hands below the table's minimum fan
+
+    // Final score of each player in each session
+    double mean = 0;
+    double stddev = 0;
+    int min = 0;
+    int max = 0;
+    int p1 = 0;
+    int p5 = 0;
+    int p25 = 0;
+    int p50 = 0;
+    int p75 = 0;
+    int p95 = 0;
+    int p99 = 0;
+
+    // Points won by the winner of each hand
+    double hand_mean = 0;
+    double hand_stddev = 0;
+
+    double bust_rate = 0;         // Share of player-sessions that bust
+    double session_bust_rate = 0; // Share of sessions where anyone busts
+};
+
+bool parse_pairs(const std::string &spec, std::map<int, int> &pairs);
+
+std::map<int, int> default_fan_weights();
+
+Result run(const Config &config);
+
+void print(const Config &config, const Result &result, std::ostream &out);
+
+} // namespace simulate
+
+#endif // __SIMULATE_H
@@ -0,0 +1,144 @@
+#include "snapshot.h"
+#include "metrics.h"
+#include "session_file.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace
+{
+
+/**
+ * Force a file or directory to stable storage
+ * @param path Path of the file or directory
+ * @return True if successful, false otherwise
+ */
+bool sync_path(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    const bool synced = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+}
+
+/**
+ * Get the directory holding a file
+ * @param filename Path of the file
+ * @return Directory part of the path, or "." if it has none
+ */
+std::string directory(const std::string &filename)
+{
+    const auto slash = filename.rfind('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+
+    return slash == 0 ? "/" : filename.substr(0, slash);
+}
+
+} // namespace
+
+namespace snapshot
+{
+
+/**
+ * Generate snapshot filename for a history file
+ * @param history_filename Path of the history file
+ * @return Path of the snapshot
+ */
+const std::string filename(const std::string &history_filename)
+{
+    return history_filename + ".snap";
+}
+
+/**
+ * Write a snapshot, replacing any existing one atomically
+ * @param filename Path of the snapshot
+ * @param game Game to save
+ * @param history_offset Bytes of history covered by the snapshot
+ * @return True if successful, false otherwise
+ */
+bool write(const std::string &filename,
+           const PureHonours &game,
+           long long history_offset)
+{
+    METRICS_TIME(Snapshot);
+    METRICS_ADD(SnapshotWrites, 1);
+
+    // The new snapshot must be on disk before it replaces the old one, and
+    // the rename must be on disk before the snapshot is relied on
+    const auto temp_name = filename + ".tmp";
+    if (!session_file::write(temp_name, game, history_offset) || !sync_path(temp_name)) {
+        std::remove(temp_name.c_str());
+        return false;
+    }
+
+    return std::rename(temp_name.c_str(), filename.c_str()) == 0 &&
+           sync_path(directory(filename));
+}
+
+/**
+ * Rebuild a game from a snapshot
+ * @param filename Path of the snapshot
+ * @param history_offset Set to bytes of history covered by the snapshot
+ * @return Restored game, or nullptr if missing or invalid
+ */
+std::unique_ptr<PureHonours> read(const std::string &filename,
+                                  long long &history_offset)
+{
+    session_file::Reader reader;
+    if (!reader.open(filename)) {
+        return nullptr;
+    }
+
+    auto game = session_file::load(reader);
+    if (game) {
+        history_offset = reader.header().history_offset;
+    }
+
+    return game;
+}
+
+/**
+ * Rebuild a session from its history, starting from the latest snapshot
+ * @param history_filename Path of the history file
+ * @param session Fresh session to rebuild into
+ * @return True if the history could be read, false otherwise
+ */
+bool resume(const std::string &history_filename, Session &session)
+{
+    std::ifstream history(history_filename, std::ios_base::in | std::ios_base::binary);
+    if (!history.is_open()) {
+        return false;
+    }
+
+    history.seekg(0, std::ios_base::end);
+    const long long size = history.tellg();
+
+    // Only trust a snapshot whose offset lands on a record boundary
+    long long offset = 0;
+    auto game = read(filename(history_filename), offset);
+    if (game && offset > 0 && offset <= size) {
+        char last = 0;
+        history.seekg(offset - 1);
+        if (history.get(last) && last == '\n') {
+            session.restore(std::move(game));
+        } else {
+            offset = 0;
+        }
+    } else {
+        offset = 0;
+    }
+
+    history.clear();
+    history.seekg(offset);
+    session.replay(history);
+    return true;
+}
+
+} // namespace snapshot
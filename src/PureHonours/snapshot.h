@@ -0,0 +1,28 @@
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include "purehonours.h"
+#include "session.h"
+
+#include <memory>
+#include <string>
+
+// Binary snapshots of game state, taken alongside the history journal so a
+// resume only has to replay the records appended after the latest one
+namespace snapshot
+{
+
+const std::string filename(const std::string &history_filename);
+
+bool write(const std::string &filename,
+           const PureHonours &game,
+           long long history_offset);
+
+std::unique_ptr<PureHonours> read(const std::string &filename,
+                                  long long &history_offset);
+
+bool resume(const std::string &history_filename, Session &session);
+
+} // namespace snapshot
+
+#endif // __SNAPSHOT_H
@@ -0,0 +1,296 @@
+#include "statistics.h"
+#include "purehonours.h"
+
+/**
+ * Get highest fan won with
+ * @return Highest fan, or 0 if no wins
+ */
+int PlayerStats::max_fan() const
+{
+    for (auto fan = fan_counts.size(); fan > 0; --fan) {
+        if (fan_counts[fan - 1] > 0) {
+            return static_cast<int>(fan - 1);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Add or remove a win at a fan, growing the histogram as needed
+ * @param fan Fan won with
+ * @param direction 1 to add, -1 to remove
+ */
+void PlayerStats::count_fan(std::uint8_t fan, int direction)
+{
+    if (fan >= fan_counts.size()) {
+        fan_counts.resize(fan + 1u, 0);
+    }
+    fan_counts[fan] += direction;
+}
+
+/**
+ * Compare counters
+ * @param other Counters to compare against
+ * @return True if every counter matches
+ */
+bool PlayerStats::operator==(const PlayerStats &other) const
+{
+    // Histograms may differ in length, as removing a win never shrinks one
+    const auto &shorter = fan_counts.size() < other.fan_counts.size() ? fan_counts : other.fan_counts;
+    const auto &longer = &shorter == &fan_counts ? other.fan_counts : fan_counts;
+    for (std::size_t fan = 0; fan < longer.size(); ++fan) {
+        if (longer[fan] != (fan < shorter.size() ? shorter[fan] : 0)) {
+            return false;
+        }
+    }
+
+    return wins == other.wins &&
+           self_draws == other.self_draws &&
+           fan_total == other.fan_total &&
+           fed_count == other.fed_count &&
+           fed_points == other.fed_points &&
+           gong_count == other.gong_count &&
+           gong_points == other.gong_points;
+}
+
+/**
+ * Reserve space in every column
+ * @param count Number of rounds
+ */
+void RoundColumns::reserve(std::size_t count)
+{
+    winner.reserve(count);
+    loser.reserve(count);
+    fan.reserve(count);
+    flags.reserve(count);
+    paid.reserve(count);
+}
+
+/**
+ * Append a round to the columns
+ * @param round Round to append
+ * @param scores Score change of each player in the round
+ */
+void RoundColumns::append(const Round &round, const int *scores)
+{
+    winner.push_back(round.winning_player);
+    loser.push_back(round.losing_player);
+    fan.push_back(round.fan);
+    flags.push_back(round.flags);
+
+    // A plain self-draw has no named loser
+    const bool named_loser = !round.self_draw() || round.gong_direct();
+    paid.push_back(named_loser ? -scores[round.losing_player] : 0);
+}
+
+/**
+ * Get number of rounds
+ * @return Number of rounds
+ */
+std::size_t RoundColumns::size() const
+{
+    return winner.size();
+}
+
+/**
+ * Constructor for statistics
+ * @param player_count Number of players
+ */
+Statistics::Statistics(int player_count)
+: player_count_(player_count),
+  rounds_(0),
+  players_(static_cast<std::size_t>(player_count))
+{
+}
+
+/**
+ * Recompute statistics from scratch
+ *
+ * Each counter is a branch-free pass over one or two byte columns so the
+ * loops vectorize.
+ *
+ * @param columns Rounds to aggregate
+ * @param player_count Number of players
+ * @return Statistics for the rounds
+ */
+Statistics Statistics::compute(const RoundColumns &columns, int player_count)
+{
+    Statistics stats(player_count);
+    stats.rounds_ = columns.size();
+
+    const std::size_t n = columns.size();
+    const std::uint8_t *winner = columns.winner.data();
+    const std::uint8_t *loser = columns.loser.data();
+    const std::uint8_t *fan = columns.fan.data();
+    const std::uint8_t *flags = columns.flags.data();
+    const std::int32_t *paid = columns.paid.data();
+
+    for (int p = 0; p < player_count; ++p) {
+        auto &player = stats.players_[static_cast<std::size_t>(p)];
+        const auto id = static_cast<std::uint8_t>(p);
+
+        std::uint32_t wins = 0;
+        std::uint32_t self_draws = 0;
+        std::int64_t fan_total = 0;
+        std::uint32_t fed_count = 0;
+        std::int64_t fed_points = 0;
+        std::uint32_t gong_count = 0;
+        std::int64_t gong_points = 0;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint32_t won = winner[i] == id;
+            const std::uint32_t self = flags[i] & Round::SELF_DRAW;
+            const std::uint32_t gong = (flags[i] & Round::GONG_DIRECT) >> 1;
+            const std::uint32_t lost = loser[i] == id;
+            const std::uint32_t fed = lost & (self ^ 1);
+            const std::uint32_t gonged = lost & self & gong; // A fed win never counts as a gong
+
+            // Paid goes negative when a winner is entered as their own feeder,
+            // so multiply in signed arithmetic
+            wins += won;
+            self_draws += won & self;
+            fan_total += won * fan[i];
+            fed_count += fed;
+            fed_points += static_cast<std::int64_t>(fed) * paid[i];
+            gong_count += gonged;
+            gong_points += static_cast<std::int64_t>(gonged) * paid[i];
+        }
+
+        player.wins = wins;
+        player.self_draws = self_draws;
+        player.fan_total = fan_total;
+        player.fed_count = fed_count;
+        player.fed_points = fed_points;
+        player.gong_count = gong_count;
+        player.gong_points = gong_points;
+    }
+
+    // Fan histograms are a scatter, so do them in one separate pass
+    for (std::size_t i = 0; i < n; ++i) {
+        stats.players_[winner[i]].count_fan(fan[i], 1);
+    }
+
+    return stats;
+}
+
+/**
+ * Count a new round
+ * @param round Round added
+ * @param scores Score change of each player in the round
+ */
+void Statistics::add(const Round &round, const int *scores)
+{
+    ++rounds_;
+    apply(round, scores, 1);
+}
+
+/**
+ * Uncount a deleted round
+ * @param round Round deleted
+ * @param scores Score change of each player in the round
+ */
+void Statistics::remove(const Round &round, const int *scores)
+{
+    --rounds_;
+    apply(round, scores, -1);
+}
+
+/**
+ * Compare statistics
+ * @param other Statistics to compare against
+ * @return True if every player's counters match
+ */
+bool Statistics::operator==(const Statistics &other) const
+{
+    return player_count_ == other.player_count_ &&
+           rounds_ == other.rounds_ &&
+           players_ == other.players_;
+}
+
+/**
+ * Get number of players
+ * @return Number of players
+ */
+int Statistics::player_count() const
+{
+    return player_count_;
+}
+
+/**
+ * Get number of rounds counted
+ * @return Number of rounds
+ */
+std::size_t Statistics::rounds() const
+{
+    return rounds_;
+}
+
+/**
+ * Get counters for a player
+ * @param index Index of player
+ * @return Player's counters
+ */
+const PlayerStats &Statistics::player(std::size_t index) const
+{
+    return players_.at(index);
+}
+
+/**
+ * Get share of rounds won
+ * @param index Index of player
+ * @return Wins per round, or 0 if no rounds
+ */
+double Statistics::win_rate(std::size_t index) const
+{
+    return rounds_ > 0 ? static_cast<double>(player(index).wins) / rounds_ : 0.0;
+}
+
+/**
+ * Get share of wins by self-draw
+ * @param index Index of player
+ * @return Self-draws per win, or 0 if no wins
+ */
+double Statistics::self_draw_rate(std::size_t index) const
+{
+    const auto &stats = player(index);
+    return stats.wins > 0 ? static_cast<double>(stats.self_draws) / stats.wins : 0.0;
+}
+
+/**
+ * Get average fan of winning hands
+ * @param index Index of player
+ * @return Average fan, or 0 if no wins
+ */
+double Statistics::average_fan(std::size_t index) const
+{
+    const auto &stats = player(index);
+    return stats.wins > 0 ? static_cast<double>(stats.fan_total) / stats.wins : 0.0;
+}
+
+/**
+ * Add or remove a round's contribution
+ * @param round Round to apply
+ * @param scores Score change of each player in the round
+ * @param direction 1 to add, -1 to remove
+ */
+void Statistics::apply(const Round &round, const int *scores, int direction)
+{
+    auto &winner = players_[round.winning_player];
+    winner.wins += direction;
+    winner.fan_total += direction * round.fan;
+    winner.count_fan(round.fan, direction);
+    if (round.self_draw()) {
+        winner.self_draws += direction;
+    }
+
+    auto &loser = players_[round.losing_player];
+    const int paid = -scores[round.losing_player];
+    if (!round.self_draw()) {
+        loser.fed_count += direction;
+        loser.fed_points += direction * paid;
+    } else if (round.gong_direct()) {
+        loser.gong_count += direction;
+        loser.gong_points += direction * paid;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef __STATISTICS_H
+#define __STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Round;
+
+// Counters for one player
+struct PlayerStats {
+    std::size_t wins = 0;
+    std::size_t self_draws = 0;
+    long long fan_total = 0;
+    std::size_t fed_count = 0;
+    long long fed_points = 0;
+    std::size_t gong_count = 0;
+    long long gong_points = 0;
+
+    // Winning hands by fan, so the maximum survives deletions. Only as long
+    // as the highest fan won, so copying a game stays cheap
+    std::vector<std::uint32_t> fan_counts;
+
+    int max_fan() const;
+    void count_fan(std::uint8_t fan, int direction);
+    bool operator==(const PlayerStats &other) const;
+};
+
+/**
+ * Rounds stored column by column for bulk aggregation
+ */
+struct RoundColumns {
+    std::vector<std::uint8_t> winner;
+    std::vector<std::uint8_t> loser;
+    std::vector<std::uint8_t> fan;
+    std::vector<std::uint8_t> flags;
+    std::vector<std::int32_t> paid; // Points paid by the named loser
+
+    void reserve(std::size_t count);
+    void append(const Round &round, const int *scores);
+    std::size_t size() const;
+};
+
+/**
+ * Per-player statistics, kept up to date one round at a time
+ */
+class Statistics {
+public:
+    explicit Statistics(int player_count);
+
+    static Statistics compute(const RoundColumns &columns, int player_count);
+
+    void add(const Round &round, const int *scores);
+    void remove(const Round &round, const int *scores);
+
+    bool operator==(const Statistics &other) const;
+
+    int player_count() const;
+    std::size_t rounds() const;
+    const PlayerStats &player(std::size_t index) const;
+
+    double win_rate(std::size_t index) const;
+    double self_draw_rate(std::size_t index) const;
+    double average_fan(std::size_t index) const;
+
+private:
+    int player_count_;
+    std::size_t rounds_;
+    std::vector<PlayerStats> players_;
+
+    void apply(const Round &round, const int *scores, int direction);
+};
+
+#endif // __STATISTICS_H
@@ -0,0 +1,152 @@
+#include "tokens.h"
+
+#include <climits>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+/**
+ * Check for whitespace without locale lookups
+ * @param c Character to check
+ * @return True if c is whitespace, false otherwise
+ */
+bool is_space(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Parse the leading digits of a token
+ *
+ * Like std::stoi, anything after the digits is ignored, so recorded histories
+ * replay exactly as they did before.
+ * @param data First character to parse
+ * @param end One past the last character
+ * @param limit Largest acceptable magnitude
+ * @param value Set to the magnitude if successful
+ * @return True if at least one digit was read without exceeding limit
+ */
+bool parse_digits(const char *data,
+                  const char *end,
+                  unsigned long long limit,
+                  unsigned long long &value)
+{
+    if (data == end || *data < '0' || *data > '9') {
+        return false;
+    }
+
+    unsigned long long result = 0;
+    for (; data != end && *data >= '0' && *data <= '9'; ++data) {
+        const unsigned digit = static_cast<unsigned>(*data - '0');
+        if (result > (limit - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+
+    value = result;
+    return true;
+}
+
+} // namespace
+
+namespace tokens
+{
+
+/**
+ * Compare with a C string
+ * @param text String to compare with
+ * @return True if the token holds exactly text, false otherwise
+ */
+bool Token::operator==(const char *text) const
+{
+    return std::strlen(text) == size && std::memcmp(data, text, size) == 0;
+}
+
+/**
+ * Split a line into whitespace-separated tokens
+ * @param line Input line
+ * @param size Length of line
+ * @param tokens Filled with tokens pointing into line
+ * @param max Capacity of tokens; later words are dropped
+ * @return Number of tokens filled in
+ */
+std::size_t split(const char *line, std::size_t size, Token *tokens, std::size_t max)
+{
+    const char *end = line + size;
+    std::size_t count = 0;
+    while (count < max) {
+        while (line != end && is_space(*line)) {
+            ++line;
+        }
+
+        if (line == end) {
+            break;
+        }
+
+        const char *start = line;
+        while (line != end && !is_space(*line)) {
+            ++line;
+        }
+
+        tokens[count].data = start;
+        tokens[count].size = static_cast<std::size_t>(line - start);
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * Parse a signed integer
+ * @param token Token to parse
+ * @param value Set to the number if successful
+ * @return True if the token starts with an in-range integer, false otherwise
+ */
+bool to_int(const Token &token, int &value)
+{
+    const char *data = token.data;
+    const char *end = token.data + token.size;
+    const bool negative = data != end && *data == '-';
+    if (data != end && (*data == '-' || *data == '+')) {
+        ++data;
+    }
+
+    const unsigned long long limit =
+        negative ? static_cast<unsigned long long>(INT_MAX) + 1 : INT_MAX;
+    unsigned long long magnitude;
+    if (!parse_digits(data, end, limit, magnitude)) {
+        return false;
+    }
+
+    value = negative ? static_cast<int>(-static_cast<long long>(magnitude))
+                     : static_cast<int>(magnitude);
+    return true;
+}
+
+/**
+ * Parse a non-negative count or index
+ * @param token Token to parse
+ * @param value Set to the number if successful
+ * @return True if the token starts with an in-range number, false otherwise
+ */
+bool to_size(const Token &token, std::size_t &value)
+{
+    const char *data = token.data;
+    const char *end = token.data + token.size;
+    if (data != end && *data == '+') {
+        ++data;
+    }
+
+    unsigned long long result;
+    if (!parse_digits(data, end, std::numeric_limits<std::size_t>::max(), result)) {
+        return false;
+    }
+
+    value = static_cast<std::size_t>(result);
+    return true;
+}
+
+} // namespace tokens
@@ -0,0 +1,42 @@
+#ifndef __TOKENS_H
+#define __TOKENS_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Zero-copy command tokenizing and number parsing
+ *
+ * Tokens point into the caller's line, which must outlive them, so splitting
+ * and parsing a command never touch the heap.
+ */
+namespace tokens
+{
+
+// Most tokens kept from one line; the grammar never needs more
+const std::size_t MAX_TOKENS = 8;
+
+/**
+ * One whitespace-separated word of a line
+ */
+struct Token {
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+    Token() = default;
+    Token(const char *data, std::size_t size) : data(data), size(size) {}
+
+    bool empty() const { return size == 0; }
+    char front() const { return size > 0 ? data[0] : '\0'; }
+    bool operator==(const char *text) const;
+    bool operator!=(const char *text) const { return !(*this == text); }
+    std::string str() const { return std::string(data, size); }
+};
+
+std::size_t split(const char *line, std::size_t size, Token *tokens, std::size_t max);
+bool to_int(const Token &token, int &value);
+bool to_size(const Token &token, std::size_t &value);
+
+} // namespace tokens
+
+#endif // __TOKENS_H
@@ -0,0 +1,359 @@
+#include "PureHonours/purehonours.h"
+#include "PureHonours/session.h"
+#include "PureHonours/statistics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Names used for synthetic players
+const char *const NAMES[] = {"A", "B", "C", "D"};
+
+// Operations timed per benchmark for the shorter sessions
+const std::size_t TARGET_OPS = 1000000;
+
+// Deletions timed per session for delete_score(index)
+const std::size_t DELETES = 100;
+
+/**
+ * Stream buffer that counts and drops everything written to it
+ */
+class CountingBuffer : public std::streambuf {
+public:
+    std::size_t bytes = 0;
+
+protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override
+    {
+        bytes += static_cast<std::size_t>(count);
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        ++bytes;
+        return traits_type::not_eof(c);
+    }
+};
+
+// One synthetic round
+struct Entry {
+    std::size_t winner;
+    int fan;
+    bool self_draw;
+    std::size_t loser;
+    bool gong_direct;
+};
+
+/**
+ * Generate a reproducible mix of rounds
+ * @param players Number of players
+ * @param rounds Number of rounds
+ * @return Generated rounds
+ */
+std::vector<Entry> generate(int players, std::size_t rounds)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> seat(0, players - 1);
+    std::uniform_int_distribution<int> fan(3, 13);
+    std::uniform_int_distribution<int> kind(0, 9);
+
+    std::vector<Entry> entries;
+    entries.reserve(rounds);
+    while (entries.size() < rounds) {
+        Entry entry;
+        entry.winner = static_cast<std::size_t>(seat(rng));
+        entry.fan = fan(rng);
+        entry.loser = static_cast<std::size_t>(seat(rng));
+        if (entry.loser == entry.winner) {
+            entry.loser = (entry.loser + 1) % static_cast<std::size_t>(players);
+        }
+
+        // 30% self-draw, 10% self-draw off a gong, 60% fed
+        auto k = kind(rng);
+        entry.self_draw = k < 4;
+        entry.gong_direct = k == 3;
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+/**
+ * Build a quiet game with the default fans
+ * @param players Number of players
+ * @return New game
+ */
+PureHonours make_game(int players)
+{
+    PureHonours game(players, std::vector<std::string>(NAMES, NAMES + players));
+    game.set_output(nullptr);
+    game.default_fans();
+    return game;
+}
+
+/**
+ * Build a quiet game holding the given rounds
+ * @param players Number of players
+ * @param entries Rounds to add
+ * @return New game
+ */
+PureHonours make_game(int players, const std::vector<Entry> &entries)
+{
+    auto game = make_game(players);
+    for (auto &e : entries) {
+        game.add_result(e.winner, e.fan, e.self_draw, e.loser, e.gong_direct);
+    }
+
+    return game;
+}
+
+/**
+ * Render rounds in the history command grammar
+ * @param players Number of players
+ * @param entries Rounds to render
+ * @return History text
+ */
+std::string history_text(int players, const std::vector<Entry> &entries)
+{
+    std::ostringstream ss;
+    ss << players << '\n';
+    for (int i = 0; i < players; ++i) {
+        ss << NAMES[i] << '\n';
+    }
+    ss << "d\n";
+
+    for (auto &e : entries) {
+        ss << "a " << NAMES[e.winner] << ' ' << e.fan << ' ';
+        if (e.self_draw && e.gong_direct) {
+            ss << "selfg " << NAMES[e.loser];
+        } else if (e.self_draw) {
+            ss << "self";
+        } else {
+            ss << NAMES[e.loser];
+        }
+        ss << '\n';
+    }
+
+    return ss.str();
+}
+
+/**
+ * Print one result as a JSON line
+ * @param name Benchmark name
+ * @param players Number of players
+ * @param rounds Session length
+ * @param ops Operations timed
+ * @param elapsed Time taken for all operations
+ */
+void emit(const std::string &name,
+          int players,
+          std::size_t rounds,
+          std::size_t ops,
+          Clock::duration elapsed)
+{
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << "{\"bench\":\"" << name << "\""
+              << ",\"players\":" << players
+              << ",\"rounds\":" << rounds
+              << ",\"ops\":" << ops
+              << ",\"total_ns\":" << static_cast<long long>(ns)
+              << ",\"ns_per_op\":" << (ops > 0 ? ns / ops : 0.0)
+              << "}" << std::endl;
+}
+
+/**
+ * Run every benchmark for one session shape
+ * @param players Number of players
+ * @param rounds Session length
+ */
+void run(int players, std::size_t rounds)
+{
+    const auto entries = generate(players, rounds);
+    const std::size_t repeats = std::max<std::size_t>(1, TARGET_OPS / rounds);
+
+    // add_result: fill a fresh game
+    {
+        Clock::duration elapsed(0);
+        for (std::size_t r = 0; r < repeats; ++r) {
+            auto game = make_game(players);
+            const auto start = Clock::now();
+            for (auto &e : entries) {
+                game.add_result(e.winner, e.fan, e.self_draw, e.loser, e.gong_direct);
+            }
+            elapsed += Clock::now() - start;
+        }
+        emit("add_result", players, rounds, rounds * repeats, elapsed);
+    }
+
+    auto game = make_game(players, entries);
+
+    // fan_score: look up every round's fan
+    {
+        volatile int sink = 0;
+        const auto start = Clock::now();
+        for (std::size_t r = 0; r < repeats; ++r) {
+            for (auto &e : entries) {
+                sink = sink + game.fan_score(e.fan, e.self_draw);
+            }
+        }
+        emit("fan_score", players, rounds, rounds * repeats, Clock::now() - start);
+    }
+
+    // tally: full recompute of totals
+    {
+        volatile int sink = 0;
+        const auto start = Clock::now();
+        for (std::size_t r = 0; r < repeats; ++r) {
+            sink = sink + game.tally()[0];
+        }
+        emit("tally", players, rounds, repeats, Clock::now() - start);
+    }
+
+    // statistics_compute: recompute player statistics from columns
+    {
+        const auto columns = game.columns();
+        volatile std::size_t sink = 0;
+        const std::size_t passes = std::max<std::size_t>(1, repeats / 10);
+        const auto start = Clock::now();
+        for (std::size_t r = 0; r < passes; ++r) {
+            sink = sink + Statistics::compute(columns, players).player(0).wins;
+        }
+        emit("statistics_compute", players, rounds, rounds * passes, Clock::now() - start);
+    }
+
+    // delete_score(index): delete from the middle of a full session
+    {
+        auto copy = game;
+        const std::size_t deletes = std::min(DELETES, rounds - 1);
+
+        // The copy's undo history is exactly full; let it grow outside the timing
+        copy.delete_score(1);
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < deletes; ++i) {
+            copy.delete_score(copy.round_count() / 2 + 1);
+        }
+        emit("delete_score_index", players, rounds, deletes, Clock::now() - start);
+    }
+
+    // print_report: render the full table into a counting stream
+    {
+        CountingBuffer buffer;
+        std::ostream out(&buffer);
+        game.set_output(&out);
+        const std::size_t renders = std::max<std::size_t>(1, repeats / 100);
+        const auto start = Clock::now();
+        for (std::size_t r = 0; r < renders; ++r) {
+            game.print_report();
+        }
+        emit("print_report", players, rounds, renders, Clock::now() - start);
+        game.set_output(nullptr);
+    }
+
+    // print_csv: export to a file in the scratch directory
+    {
+        const std::size_t exports = std::max<std::size_t>(1, repeats / 100);
+        const auto start = Clock::now();
+        for (std::size_t r = 0; r < exports; ++r) {
+            game.print_csv();
+        }
+        emit("print_csv", players, rounds, exports, Clock::now() - start);
+    }
+
+    // History replay: rebuild a session from its command log
+    {
+        const auto text = history_text(players, entries);
+        const std::size_t replays = std::max<std::size_t>(1, repeats / 10);
+        Clock::duration elapsed(0);
+        for (std::size_t r = 0; r < replays; ++r) {
+            std::istringstream in(text);
+            Session session(nullptr);
+            const auto start = Clock::now();
+            session.replay(in);
+            elapsed += Clock::now() - start;
+        }
+        emit("history_replay", players, rounds, rounds * replays, elapsed);
+    }
+}
+
+/**
+ * Remove a scratch directory and the exports written into it
+ * @param path Directory to remove
+ */
+void remove_scratch(const std::string &path)
+{
+    auto dir = ::opendir(path.c_str());
+    if (dir) {
+        while (auto entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                std::remove((path + "/" + name).c_str());
+            }
+        }
+        ::closedir(dir);
+    }
+
+    ::rmdir(path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t max_rounds = 1000000;
+    int min_players = 2;
+    int max_players = 4;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        try {
+            if (arg == "--max-rounds") {
+                max_rounds = std::stoul(argv[i + 1]);
+            } else if (arg == "--players") {
+                min_players = max_players = std::stoi(argv[i + 1]);
+            } else {
+                std::cerr << "Invalid option: " << arg << std::endl;
+                return 1;
+            }
+        } catch (std::exception &) {
+            std::cerr << "Invalid value for option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc % 2 == 0 || min_players < 2 || max_players > 4) {
+        std::cerr << "Usage: purehonours_bench [--max-rounds N] [--players 2|3|4]" << std::endl;
+        return 1;
+    }
+
+    // CSV exports are written to the working directory, so use a scratch one
+    char scratch[] = "/tmp/purehonours_bench.XXXXXX";
+    if (!::mkdtemp(scratch) || ::chdir(scratch) != 0) {
+        std::cerr << "Failed to create scratch directory." << std::endl;
+        return 1;
+    }
+
+    for (int players = min_players; players <= max_players; ++players) {
+        for (std::size_t rounds = 10; rounds <= max_rounds; rounds *= 10) {
+            run(players, rounds);
+        }
+    }
+
+    remove_scratch(scratch);
+    return 0;
+}
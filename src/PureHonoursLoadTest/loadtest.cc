@@ -0,0 +1,346 @@
+#include "PureHonours/batch.h"
+#include "PureHonours/delta_csv.h"
+#include "PureHonours/exporter.h"
+#include "PureHonours/generate.h"
+#include "PureHonours/purehonours.h"
+#include "PureHonours/session.h"
+#include "PureHonours/simulate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Name of the generated log in the scratch directory
+const char *const LOG_NAME = "session.purehonours";
+
+// Latency of one kind of export over several runs
+struct Latency {
+    std::size_t runs = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+
+    void add(Clock::duration elapsed)
+    {
+        const double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        ++runs;
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+    }
+};
+
+/**
+ * Get seconds between two times
+ * @param start Earlier time
+ * @param end Later time
+ * @return Seconds elapsed
+ */
+double seconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Print one replay result as a JSON line
+ * @param phase What was replayed
+ * @param commands Commands replayed
+ * @param rounds Live rounds afterwards, or 0 if unknown
+ * @param elapsed Seconds taken
+ * @param peak_rss_kb Peak resident set size in kilobytes
+ * @param ok Whether the replay succeeded and, run in-process, matched the log
+ */
+void emit_replay(const std::string &phase,
+                 std::size_t commands,
+                 std::size_t rounds,
+                 double elapsed,
+                 long peak_rss_kb,
+                 bool ok)
+{
+    std::cout << "{\"phase\":\"" << phase << "\""
+              << ",\"commands\":" << commands
+              << ",\"rounds\":" << rounds
+              << ",\"seconds\":" << elapsed
+              << ",\"commands_per_sec\":" << (elapsed > 0 ? commands / elapsed : 0.0)
+              << ",\"peak_rss_kb\":" << peak_rss_kb
+              << ",\"ok\":" << (ok ? "true" : "false")
+              << "}" << std::endl;
+}
+
+/**
+ * Print one export latency as a JSON line
+ * @param name Kind of export
+ * @param rounds Live rounds in the game
+ * @param latency Measured latency
+ */
+void emit_export(const std::string &name, std::size_t rounds, const Latency &latency)
+{
+    std::cout << "{\"export\":\"" << name << "\""
+              << ",\"rounds\":" << rounds
+              << ",\"runs\":" << latency.runs
+              << ",\"mean_ms\":" << (latency.runs > 0 ? latency.total_ms / latency.runs : 0.0)
+              << ",\"max_ms\":" << latency.max_ms
+              << "}" << std::endl;
+}
+
+/**
+ * Replay the log through the batch entry point and check the result
+ * @param counts What the log holds
+ * @return Replayed session
+ */
+Session replay(const generate::Counts &counts)
+{
+    Session session(nullptr);
+    std::FILE *in = std::fopen(LOG_NAME, "rb");
+    if (!in) {
+        std::cerr << "Failed to open file for reading: " << LOG_NAME << std::endl;
+        std::exit(1);
+    }
+
+    const auto start = Clock::now();
+    const auto commands = batch::run(in, session);
+    const auto end = Clock::now();
+    std::fclose(in);
+
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+
+    auto game = session.game();
+    const bool consistent = game && commands == counts.lines &&
+                            game->round_count() == counts.rounds &&
+                            game->totals() == game->tally();
+    emit_replay("batch", commands, game ? game->round_count() : 0,
+                seconds(start, end), usage.ru_maxrss, consistent);
+    if (!consistent) {
+        std::cerr << "Replayed game does not match the generated log." << std::endl;
+        std::exit(1);
+    }
+
+    return session;
+}
+
+/**
+ * Time each way of exporting the replayed game
+ * @param game Replayed game; hands are added to it for delta exports
+ * @param runs Exports of each kind to time
+ */
+void time_exports(PureHonours &game, std::size_t runs)
+{
+    const auto rounds = game.round_count();
+
+    Latency csv;
+    Latency session_file;
+    for (std::size_t r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        game.print_csv();
+        csv.add(Clock::now() - start);
+
+        start = Clock::now();
+        game.export_file();
+        session_file.add(Clock::now() - start);
+    }
+    emit_export("csv", rounds, csv);
+    emit_export("session_file", rounds, session_file);
+
+    // Background exports: how long entry is held up, then until written
+    Latency submit;
+    Latency written;
+    {
+        Exporter exporter;
+        for (std::size_t r = 0; r < runs; ++r) {
+            const auto start = Clock::now();
+            exporter.submit(game, Exporter::Format::Csv);
+            submit.add(Clock::now() - start);
+            exporter.wait();
+            written.add(Clock::now() - start);
+        }
+    }
+    emit_export("background_submit", rounds, submit);
+    emit_export("background_written", rounds, written);
+
+    // Delta CSV: one full write, then one hand and one export at a time
+    DeltaCsv delta;
+    Latency first;
+    Latency hand;
+    auto start = Clock::now();
+    delta.write(game);
+    first.add(Clock::now() - start);
+    for (std::size_t r = 0; r < runs * 100; ++r) {
+        game.add_result(r % static_cast<std::size_t>(game.player_count()), 5, true);
+        start = Clock::now();
+        delta.write(game);
+        hand.add(Clock::now() - start);
+    }
+    emit_export("delta_first", rounds, first);
+    emit_export("delta_per_hand", game.round_count(), hand);
+}
+
+/**
+ * Replay the log through the real binary and measure it from outside
+ * @param binary Path of the purehonours binary
+ * @param counts What the log holds
+ * @return True if the binary ran successfully, false otherwise
+ */
+bool run_binary(const std::string &binary, const generate::Counts &counts)
+{
+    const auto start = Clock::now();
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        return false;
+    } else if (pid == 0) {
+        const int null = ::open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            ::dup2(null, STDOUT_FILENO);
+        }
+
+        ::execl(binary.c_str(), binary.c_str(), "--batch", LOG_NAME, "--report", "none",
+                static_cast<char *>(nullptr));
+        std::_Exit(127);
+    }
+
+    int status = 0;
+    rusage usage;
+    if (::wait4(pid, &status, 0, &usage) != pid) {
+        return false;
+    }
+
+    const bool succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    emit_replay("binary", counts.lines, 0, seconds(start, Clock::now()), usage.ru_maxrss, succeeded);
+    return succeeded;
+}
+
+/**
+ * Remove a scratch directory and the files written into it
+ * @param path Directory to remove
+ */
+void remove_scratch(const std::string &path)
+{
+    auto dir = ::opendir(path.c_str());
+    if (dir) {
+        while (auto entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                std::remove((path + "/" + name).c_str());
+            }
+        }
+        ::closedir(dir);
+    }
+
+    ::rmdir(path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    generate::Config config;
+    config.hands = 1000000;
+    std::size_t exports = 5;
+    std::string binary;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        const std::string value = argv[i + 1];
+        try {
+            if (arg == "--hands") {
+                config.hands = std::stoul(value);
+            } else if (arg == "--players") {
+                config.players = std::stoi(value);
+            } else if (arg == "--self-draw") {
+                config.self_draw = std::stod(value);
+            } else if (arg == "--gong-direct") {
+                config.gong_direct = std::stod(value);
+            } else if (arg == "--delete-rate") {
+                config.deletes = std::stod(value);
+            } else if (arg == "--undo-rate") {
+                config.undos = std::stod(value);
+            } else if (arg == "--fan-weights" || arg == "--fan-table") {
+                auto &pairs = arg == "--fan-weights" ? config.fan_weights : config.fan_table;
+                if (!simulate::parse_pairs(value, pairs)) {
+                    std::cerr << "Invalid fan list: " << value << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--seed") {
+                config.seed = std::stoull(value);
+            } else if (arg == "--exports") {
+                exports = std::stoul(value);
+            } else if (arg == "--binary") {
+                binary = value;
+            } else {
+                std::cerr << "Invalid option: " << arg << std::endl;
+                return 1;
+            }
+        } catch (std::exception &) {
+            std::cerr << "Invalid value for option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc % 2 == 0 || !generate::valid(config)) {
+        std::cerr << "Usage: purehonours_loadtest [--hands N] [--players 2|3|4] "
+                  << "[--self-draw P] [--gong-direct P] [--delete-rate P] [--undo-rate P] "
+                  << "[--fan-weights <fan:weight,...>] [--fan-table <fan:score,...>] "
+                  << "[--seed N] [--exports N] [--binary <purehonours binary>]" << std::endl;
+        return 1;
+    }
+
+    // Run the binary from where it was given, before moving to the scratch directory
+    if (!binary.empty() && binary.find('/') != std::string::npos && binary[0] != '/') {
+        char *path = ::realpath(binary.c_str(), nullptr);
+        if (path) {
+            binary = path;
+            std::free(path);
+        }
+    }
+
+    // The log and every export are written to a scratch directory
+    char scratch[] = "/tmp/purehonours_loadtest.XXXXXX";
+    if (!::mkdtemp(scratch) || ::chdir(scratch) != 0) {
+        std::cerr << "Failed to create scratch directory." << std::endl;
+        return 1;
+    }
+
+    generate::Counts counts;
+    {
+        std::ofstream log(LOG_NAME, std::ios_base::out | std::ios_base::binary);
+        const auto start = Clock::now();
+        counts = generate::write(config, log);
+        log.close();
+        std::cout << "{\"phase\":\"generate\""
+                  << ",\"hands\":" << counts.hands
+                  << ",\"deletes\":" << counts.deletes
+                  << ",\"undos\":" << counts.undos
+                  << ",\"redos\":" << counts.redos
+                  << ",\"commands\":" << counts.lines
+                  << ",\"seconds\":" << seconds(start, Clock::now())
+                  << "}" << std::endl;
+        if (log.fail()) {
+            std::cerr << "Failed to write file: " << LOG_NAME << std::endl;
+            remove_scratch(scratch);
+            return 1;
+        }
+    }
+
+    // Run the real binary first so its peak memory is not inherited from ours
+    bool succeeded = binary.empty() || run_binary(binary, counts);
+
+    auto session = replay(counts);
+    time_exports(*session.game(), std::max<std::size_t>(1, exports));
+
+    remove_scratch(scratch);
+    return succeeded ? 0 : 1;
+}